@@ -29,6 +29,9 @@
 	#define ENGINE_ON_RPM_THRESHOLD 500		// Порог определения запуска двигателя.
 	#define ENGINE_OFF_RPM_THRESHOLD 0		// Порог определения останова двигателя.
 
+	// Второй выход скорости на OC3C (PE5), например для круиз-контроля.
+	//#define SPEED2_OUT_ENABLED
+
 	// Структура для хранения настроек.
 	typedef struct CFG_t {
 		uint16_t AfterChangeMinRPM;		// Минимальные обороты после переключения.
@@ -78,6 +81,26 @@
 
 		uint8_t TiptronicEnable;		// Ручное управление АКПП (Типтроник).
 		uint16_t TiptronicTimer;		// Время работы ручного режима АКПП (Типтроник), 1 шаг = 100 мс.
+
+		uint16_t StackMinFree;			// Минимальный допустимый запас памяти стека, байт.
+
+		uint8_t DrumAvgTime;			// Окно усреднения оборотов корзины овердрайва, мс.
+		uint8_t DrumAvgMin;				// Минимальное количество зубов в окне.
+		uint8_t DrumAvgMax;				// Максимальное количество зубов в окне (до 32).
+		uint8_t OutputAvgTime;			// Окно усреднения оборотов выходного вала, мс.
+		uint8_t OutputAvgMin;			// Минимальное количество зубов в окне.
+		uint8_t OutputAvgMax;			// Максимальное количество зубов в окне (до 32).
+
+		uint8_t TachoCylinders;			// Количество цилиндров (импульсов тахометра за 2 оборота).
+		uint8_t TachoAvgPulses;			// Количество периодов тахометра для усреднения (до 15).
+
+		uint8_t SpeedGlitchTol;			// Допустимое отклонение периода датчиков скорости от ожидаемого, % (до 30), 0 - без проверки.
+
+		uint8_t Speed2Divider;			// Второй выход скорости, зубов выходного вала на один импульс, 0 - выключен.
+		uint8_t Speed2High;				// Из них зубов в уровне HIGH (скважность), меньше делителя.
+
+		uint8_t SpeedFilterAlpha;		// Фильтр оборотов валов, коэффициент коррекции оборотов (x256), 1-192, иначе выключен.
+		uint8_t SpeedFilterBeta;		// Фильтр оборотов валов, коэффициент коррекции ускорения (x256), до 64.
 	}  CFG_t;
 
 	extern struct CFG_t CFG; 	// Делаем структуру внешней.
@@ -39,7 +39,7 @@
 	#define DEBUG_SCREEN_BUTTON_R_PIN A, 7
 	
 	// ============== DEBUG ==============
-	//Нештатный код/patch
+	// Второй выход скорости, OC3C таймера 3.
 	#define SPEED2_OUT_PIN E, 5
 #endif
 
@@ -3,6 +3,7 @@
 #include <avr/io.h>			// Названия регистров и номера бит.
 #include <stdio.h>			// Стандартная библиотека ввода/вывода.
 #include <avr/wdt.h>		// Сторожевой собак.
+#include <avr/sleep.h>		// Режимы сна.
 #include <util/delay.h>		// Задержки.
 
 #include "macros.h"			// Макросы.
@@ -24,38 +25,77 @@
 #include "buttons.h"		// Кнопки.
 #include "bmp180.h"			// Модуль измерения давления.
 #include "tacho.h"			// Тахометр двигателя (для флага EW).
+#include "scheduler.h"		// Планировщик задач.
+#include "profiler.h"		// Замер времени выполнения функций.
+#include "pressure.h"		// Управление давлением соленоидов.
+#include "critical.h"		// Критические секции.
+#include "stack.h"			// Контроль свободной памяти стека.
+#include "watchdog.h"		// Сторожевой таймер.
+#include "events.h"			// Очередь событий от прерываний.
+#include "actuator.h"		// Действия исполнительных механизмов по времени.
 
 #define VERSION_YEAR 2026
-#define VERSION_MONTH 6
-#define VERSION_DAY 19
+#define VERSION_MONTH 10
+#define VERSION_DAY 17
 #define VERSION_ADD 0
 
 // Основной счетчик времени,
 // увеличивается по прерыванию на единицу каждую 1 мс.
 volatile uint8_t MainTimer = 0;
-// Счетчик времени цикла 10 мкс.
+// Счетчик времени 10.5 мкс (CYCLE_TIMER_STEP_NS), не сбрасывается.
 volatile uint16_t CycleTimer = 0;
-
-// Счетчики времени.
-static uint16_t UartTimer = 0;
-static uint16_t SensorTimer = 0;
-static uint16_t SelectorTimer = 0;
-static uint16_t DataUpdateTimer = 0;
-static uint16_t AtModeTimer = 0;
-static uint16_t GearsTimer = 0;
-static uint16_t TPSTimer = 0;
-static uint16_t GlockTimer = 0;
-static uint16_t SLTPressureTimer = 0;
-static uint16_t SLUPressureTimer = 0;
-static uint16_t ButtonsTimer = 0;
-static uint16_t BaroTimer = 0;
+// Время от включения, мс.
+volatile uint32_t SystemTime = 0;
+// Значение CycleTimer в начале текущей миллисекунды.
+volatile uint16_t SystemTimeMark = 0;
 
 uint16_t WaitTimer = 0;		// Таймер ожидания.
-uint16_t DebugTimer = 0;	// Таймер блока отладки.
+
+static uint16_t LoadTimer = 0;	// Таймер расчета загрузки процессора, мс.
+static uint32_t IdleTime = 0;	// Время простоя за период расчета, шаги CycleTimer.
+static uint32_t LoopCount = 0;	// Количество циклов за период расчета.
 
 // Прототипы функций.
-void loop_main(uint8_t Wait);
+static void loop_main();
 static void loop_add();
+static uint16_t cpu_idle();
+static void cpu_load_update();
+
+static void task_events();
+static void task_adc();
+static void task_selector();
+static void task_tcu_data();
+static void task_tps();
+static void task_slt();
+static void task_glock();
+static void task_uart();
+static void task_baro();
+static void task_gears();
+static void task_slu_gear2();
+
+// Таблица задач.
+// Смещения разнесены, чтобы задачи с кратными периодами не совпадали по времени.
+static TASK_t Tasks[] = {
+	//	Функция				Период	Смещ.	Приор.	Флаги
+	{gear_change_step,		1,		0,		0,		TASK_RUN_IN_SHIFT | TASK_RUN_NO_CONTROL},	// Шаг процесса переключения передачи.
+	{task_events,			1,		0,		1,		TASK_RUN_IN_SHIFT | TASK_RUN_NO_CONTROL},	// Обработка событий от прерываний.
+	{task_adc,				4,		0,		2,		TASK_RUN_IN_SHIFT | TASK_RUN_NO_CONTROL},	// Считывание значений АЦП.
+	{task_selector,			202,	17,		4,		TASK_RUN_IN_SHIFT | TASK_RUN_NO_CONTROL},	// Селектор, двигатель и тормоз.
+	{task_tcu_data,			50,		2,		1,		TASK_RUN_IN_SHIFT | TASK_RUN_NO_CONTROL},	// Расчет значений TCU.
+	{task_tps,				75,		7,		3,		TASK_RUN_IN_SHIFT | TASK_RUN_NO_CONTROL},	// Расчет ДПДЗ с замедлением.
+	{task_slt,				47,		1,		0,		TASK_RUN_IN_SHIFT | TASK_RUN_NO_CONTROL},	// Управление линейными давлением.
+	{task_glock,			100,	11,		3,		TASK_RUN_IN_SHIFT | TASK_RUN_NO_CONTROL},	// Блокировка гидротрансформатора.
+	{task_uart,				50,		27,		5,		TASK_RUN_IN_SHIFT | TASK_RUN_NO_CONTROL},	// Обмен данными по UART.
+	{debug_loop,			50,		37,		7,		TASK_RUN_IN_SHIFT | TASK_RUN_NO_CONTROL},	// Режим отладки.
+	{task_baro,				20,		3,		6,		TASK_RUN_IN_SHIFT | TASK_RUN_NO_CONTROL},	// Барометр.
+	{buttons_update,		25,		5,		4,		TASK_RUN_IN_SHIFT},							// Обновление состояния кнопок.
+	{at_mode_control,		67,		19,		3,		TASK_RUN_IN_SHIFT},							// Управление режимами АКПП.
+	{task_gears,			95,		23,		2,		TASK_RUN_IN_SHIFT},							// Переключение передач.
+	{task_slu_gear2,		25,		14,		1,		0},											// Давление SLU для второй передачи.
+	{calculate_shaft_speed,	5,		4,		1,		TASK_RUN_IN_SHIFT | TASK_RUN_NO_CONTROL},	// Обороты валов и скорость авто.
+	{spdsens_diag_update,	1000,	31,		7,		TASK_RUN_IN_SHIFT | TASK_RUN_NO_CONTROL},	// Диагностика датчиков скорости.
+	{stack_check,			10,		9,		7,		TASK_RUN_IN_SHIFT | TASK_RUN_NO_CONTROL}	// Контроль свободной памяти стека.
+};
 
 int main() {
 	wdt_enable(WDTO_500MS);	// Сторожевой собак на 500 мс на время инициализации.
@@ -79,128 +119,113 @@ int main() {
 		wdt_reset();
 		read_eeprom_config();	// Чтение параметров из EEPROM.
 		wdt_reset();
+		watchdog_init();		// Чтение записи о сбросе по сторожевому таймеру.
+
+		scheduler_init(Tasks, sizeof(Tasks) / sizeof(Tasks[0]));	// Настройка планировщика задач.
+		set_sleep_mode(SLEEP_MODE_IDLE);	// Режим сна при простое, таймеры работают.
 	sei();				// Включаем глобальные прерывания.
 
 	// Версия прошивки.
 	APP.FirmwareVersion = ((VERSION_YEAR - 2026) << 11) | (VERSION_MONTH << 7) | (VERSION_DAY << 2) | VERSION_ADD;
-	wdt_enable(WDTO_250MS);	// Сторожевой собак на 250 мс.
+	watchdog_enable(WDTO_250MS);	// Сторожевой собак на 250 мс, перед сбросом запись состояния в EEPROM.
+	uart_send_crash_report();		// Причина сброса и запись о последнем сбросе.
 	while(1) {
-		loop_main(0);			// Основной цикл, выполняется всегда.
+		loop_main();			// Основной цикл.
 		loop_add();				// Вспомогательный цикл.
 	}
 	return 0;
 }
 
 // Основной цикл.
-void loop_main(uint8_t Wait) {
+static void loop_main() {
 	wdt_reset();			// Сброс сторожевого таймера.
 
 	uint8_t TimerAdd = 0;
-	cli();
+	CRITICAL_BEGIN();
 		TimerAdd = MainTimer;
 		MainTimer = 0;
-	sei();
+	CRITICAL_END();
 	
+	LoopCount++;
+
 	// Счетчики времени.
 	if (TimerAdd) {
+		scheduler_tick(TimerAdd);
 
-		UartTimer += TimerAdd;
-		SensorTimer += TimerAdd;
-		SelectorTimer += TimerAdd;
-		DataUpdateTimer += TimerAdd;
-		DebugTimer += TimerAdd;
-		TPSTimer += TimerAdd;
-		GlockTimer += TimerAdd;
-		SLTPressureTimer += TimerAdd;
-		ButtonsTimer += TimerAdd;
+		LoadTimer += TimerAdd;
+		if (LoadTimer >= 1000) {cpu_load_update();}
 
 		if (WaitTimer > TimerAdd) {WaitTimer -= TimerAdd;}
 		else {WaitTimer = 0;}
 
 		tacho_timer(TimerAdd);
-
-		// Отключение счетчиков дополнительного цикла.
-		if (!Wait) {
-			AtModeTimer += TimerAdd;
-			GearsTimer += TimerAdd;
-			SLUPressureTimer += TimerAdd;
-			BaroTimer += TimerAdd;
-		}
+		pressure_sync();	// Текущие значения давления в TCU.
 	}
 
-	// Обработка датчиков.
-	if (SensorTimer >= 4) {
-		SensorTimer = 0;
-		adc_read();					// Считывание значений АЦП.
-	}
-
-	if (SelectorTimer >= 202) {
-		SelectorTimer = 0;
-		selector_position();		// Определение позиции селектора АКПП.
-		engine_n_break_state();		// Состояние двигателя и педали тормоза.
-		rear_lamp();				// Лампа заднего хода.
-	}
+	// Состояние ЭБУ для отбора задач.
+	uint8_t State = 0;
+	// Во время переключения не выполняется управление второй передачей.
+	if (gear_change_active()) {State |= SCHED_STATE_SHIFT;}
+	// При неработающем двигателе и ручном управлении АКПП не управляется.
+	if (!TCU.EngineWork || TCU.DebugMode == 2) {State |= SCHED_STATE_NO_CONTROL;}
 
-	if (DataUpdateTimer >= 50) {
-		DataUpdateTimer = 0;
-		calculate_tcu_data();		// Расчет значений TCU.
-		update_gear_speed();		// Обновление порогов переключения передач.
-		speedometer_control();		// Выход на спидометр.
-	}
+	uint8_t N = scheduler_run(State);	// Запуск одной готовой задачи.
 
-	if (TPSTimer >= 75) {
-		TPSTimer = 0;
-		calc_tps();					// Расчет ДПДЗ с замедлением.
-	}
+	// Фиксация максимального времени цикла от предыдущей отправки пакета.
+	static uint16_t LastCycleTimer = 0;
+	uint16_t CT = 0;
+	CRITICAL_BEGIN();
+		CT = CycleTimer;
+	CRITICAL_END();
+	if (CT - LastCycleTimer > TCU.CycleTime) {TCU.CycleTime = CT - LastCycleTimer;}
+	LastCycleTimer = CT;
 
-	if (SLTPressureTimer >= 47) {
-		slt_control();				// Управление линейными давлением.
-		SLTPressureTimer = 0;
-	}	
+	// Готовых задач нет, ждем следующую миллисекунду в режиме сна.
+	// Время простоя не учитывается во времени цикла.
+	if (N == 255) {LastCycleTimer += cpu_idle();}
+}
 
-	if (GlockTimer >= 100) {
-		glock_control(GlockTimer);
-		GlockTimer = 0;
-	}
+// Простой до прерывания таймера 0, возвращает время простоя в шагах CycleTimer.
+static uint16_t cpu_idle() {
+	uint16_t Start = 0;
+	uint16_t Time = 0;
 
-	// Фиксация максимального времени цикла от предыдущей отправки пакета.
-	uint16_t CT = 0;
 	cli();
-		CT = CycleTimer;
-		CycleTimer = 0;
+		Start = CycleTimer;
+		// Таймер 2 будит контроллер каждые 10.5 мкс,
+		// поэтому засыпаем снова, пока не прошла миллисекунда.
+		while (!MainTimer) {
+			sleep_enable();
+			sei();
+			sleep_cpu();	// Команда после sei выполняется до прерываний.
+			sleep_disable();
+			cli();
+		}
+		Time = CycleTimer - Start;
 	sei();
-	if (CT > TCU.CycleTime) {TCU.CycleTime = CT;}
 
-	// Отправка данных в UART.
-	if (UartTimer >= 50) {
-		if(uart_tx_ready()) {
-			UartTimer = 0;
-			uart_command_processing();
-			uart_send_tcu_data();
-			TCU.CycleTime = 0;
+	IdleTime += Time;
+	return Time;
+}
 
-			if (TCU.AdaptationFlagTPS > 0) {TCU.AdaptationFlagTPS--;}
-			else if (TCU.AdaptationFlagTPS < 0) {TCU.AdaptationFlagTPS++;}
+// Расчет загрузки процессора и частоты цикла, вызов раз в секунду.
+static void cpu_load_update() {
+	// Простой в процентах, тик таймера 0 (992 мкс) около 94.5 шагов CycleTimer (10.5 мкс).
+	// [Простой, %] = IdleTime * CYCLE_TIMER_STEP_NS / (LoadTimer * SYSTEM_TICK_US * 10).
+	uint32_t Idle = (IdleTime * CYCLE_TIMER_STEP_NS) / ((uint32_t) LoadTimer * SYSTEM_TICK_US * 10);
+	TCU.CPULoad = 100 - MIN(Idle, 100);
 
-			if (TCU.AdaptationFlagTemp > 0) {TCU.AdaptationFlagTemp--;}
-			else if (TCU.AdaptationFlagTemp < 0) {TCU.AdaptationFlagTemp++;}
-		}
-	}
+	uint32_t Rate = (LoopCount * 1000) / LoadTimer;
+	TCU.LoopRate = MIN(Rate, UINT16_MAX);
+
+	LoadTimer = 0;
+	IdleTime = 0;
+	LoopCount = 0;
 }
 
+// Вспомогательный цикл.
 static void loop_add() {
-	lcd_process_step();
-	// Режим отладки.
-	if (DebugTimer >= 50) {
-		DebugTimer = 0;
-		debug_loop();
-	}
-
-	// Барометр.
-	if (BaroTimer >= 20) {
-		BaroTimer = 0;
-		bmp_proccess();
-	}
+	PROFILE_CALL(PROF_LCD_PROCESS_STEP, lcd_process_step());
 
 	if (TCU.DebugMode == 2) {return;}	// Ручное управление соленоидами.
 
@@ -212,49 +237,135 @@ static void loop_add() {
 		SET_PIN_LOW(SOLENOID_S4_PIN);
 
 		// Устанавливаем ШИМ на соленоидах.
-		TCU.SLT = 1023;
-		TCU.SLN = 0;
-		TCU.SLU = 0;
-
-		cli();
-			OCR1A = TCU.SLT;	// SLT (При выключенном соленоиде максимальное давление).
-			OCR1B = TCU.SLN;	// SLN.
-			OCR1C = TCU.SLU;	// SLU.
-		sei();
+		pressure_set(PRESSURE_SLT, 1023);	// SLT (При выключенном соленоиде максимальное давление).
+		pressure_set(PRESSURE_SLN, 0);		// SLN.
+		pressure_set(PRESSURE_SLU, 0);		// SLU.
 
 		TCU.ATMode = 0;	// Состояние АКПП.
 		TCU.Gear = 0;
 		TCU.Glock = 0;
-		return;
 	}
+}
 
-	if (ButtonsTimer >= 25) {
-		ButtonsTimer = 0;
-		buttons_update();	// Обновление состояния кнопок.
-	}
+// Считывание значений АЦП.
+static void task_adc() {
+	PROFILE_CALL(PROF_ADC_READ, adc_read());
+}
 
-	if (AtModeTimer >= 67) {
-		AtModeTimer = 0;
-		at_mode_control();		// Управление режимами АКПП.
-	}
+// Селектор АКПП, двигатель и тормоз.
+static void task_selector() {
+	selector_position();		// Определение позиции селектора АКПП.
+	engine_n_break_state();		// Состояние двигателя и педали тормоза.
+	rear_lamp();				// Лампа заднего хода.
+}
 
-	if (GearsTimer >= 95) {
-		GearsTimer = 0;
+// Расчет значений TCU.
+static void task_tcu_data() {
+	PROFILE_CALL(PROF_CALCULATE_TCU_DATA, calculate_tcu_data());	// Расчет значений TCU.
+	update_gear_speed();		// Обновление порогов переключения передач.
+	speedometer_control();		// Выход на спидометр.
+}
+
+// Расчет ДПДЗ с замедлением.
+static void task_tps() {
+	PROFILE_CALL(PROF_CALC_TPS, calc_tps());
+}
+
+// Управление линейными давлением.
+static void task_slt() {
+	PROFILE_CALL(PROF_SLT_CONTROL, slt_control());
+}
+
+// Блокировка гидротрансформатора.
+static void task_glock() {
+	PROFILE_CALL(PROF_GLOCK_CONTROL, glock_control(100));
+}
 
-		gear_control();
-		slip_detect();
-		buttons_clear();	// Сброс необработанных состояний.
+// Отправка данных в UART.
+static void task_uart() {
+	// Если интерфейс занят, повторяем на следующей итерации.
+	if (!uart_tx_ready()) {
+		scheduler_retry();
+		return;
 	}
 
-	if (SLUPressureTimer >= 25) {
-		SLUPressureTimer = 0;
-		slu_gear2_control();		// Управление давлением SLU для второй передачи.
+	PROFILE_CALL(PROF_UART_COMMAND, uart_command_processing());
+	PROFILE_CALL(PROF_UART_SEND_TCU_DATA, uart_send_tcu_data());
+	TCU.CycleTime = 0;
+
+	if (TCU.AdaptationFlagTPS > 0) {TCU.AdaptationFlagTPS--;}
+	else if (TCU.AdaptationFlagTPS < 0) {TCU.AdaptationFlagTPS++;}
+
+	if (TCU.AdaptationFlagTemp > 0) {TCU.AdaptationFlagTemp--;}
+	else if (TCU.AdaptationFlagTemp < 0) {TCU.AdaptationFlagTemp++;}
+}
+
+// Барометр.
+static void task_baro() {
+	PROFILE_CALL(PROF_BMP_PROCCESS, bmp_proccess());
+}
+
+// Переключение передач.
+static void task_gears() {
+	PROFILE_CALL(PROF_GEAR_CONTROL, gear_control());
+	// Нажатия кнопок во время переключения обрабатываются после его завершения.
+	if (gear_change_active()) {return;}
+
+	slip_detect();
+	buttons_clear();	// Сброс необработанных состояний.
+}
+
+// Управление давлением SLU для второй передачи.
+static void task_slu_gear2() {
+	PROFILE_CALL(PROF_SLU_GEAR2_CONTROL, slu_gear2_control());
+}
+
+// Обработка событий от прерываний.
+static void task_events() {
+	EVENT_t Event;
+	while (events_get(&Event)) {
+		switch (Event.Type) {
+			case EVENT_SELECTOR:
+				selector_position();	// Определение позиции селектора АКПП.
+				rear_lamp();			// Лампа заднего хода.
+				scheduler_wake(at_mode_control);
+				break;
+			case EVENT_BREAK:
+				TCU.Break = Event.Data;
+				scheduler_wake(at_mode_control);
+				break;
+			case EVENT_ENGINE_WORK:
+				// Отключение флага выполняется с задержкой в task_selector.
+				#ifndef USE_ENGINE_RPM
+					if (Event.Data) {TCU.EngineWork = 1;}
+				#endif
+				break;
+			case EVENT_BUTTON_UP:
+			case EVENT_BUTTON_DOWN:
+				// Длинное нажатие считается по периоду buttons_update,
+				// отпускание обрабатывается сразу вместе с переключением.
+				if (!Event.Data) {
+					buttons_update();
+					scheduler_wake(task_gears);
+				}
+				break;
+			case EVENT_DRUM_TIMEOUT:
+			case EVENT_OUTPUT_TIMEOUT:
+				scheduler_wake(calculate_shaft_speed);	// Обнуление оборотов без ожидания периода.
+				break;
+		}
 	}
 }
 
 // Прерывание при совпадении регистра сравнения OCR0A на таймере 0 каждую 1мс. 
-ISR (TIMER0_COMPA_vect) {MainTimer++;}
+ISR (TIMER0_COMPA_vect) {
+	MainTimer++;
+	SystemTime++;
+	SystemTimeMark = CycleTimer;
+	events_poll();		// Опрос входов для очереди событий.
+	actuator_tick();	// Запланированные действия текущей миллисекунды.
+}
 
-// Прерывание при совпадении регистра сравнения OCR2A на таймере 2 каждую 10 мкс. 
+// Прерывание при совпадении регистра сравнения OCR2A на таймере 2 каждые 10.5 мкс.
 ISR (TIMER2_COMPA_vect) {CycleTimer++;}
 
@@ -0,0 +1,163 @@
+#include <stdint.h>			// Коротние название int.
+#include <avr/io.h>			// Названия регистров и номера бит.
+#include <avr/interrupt.h>	// Прерывания.
+
+#include "actuator.h"		// Свой заголовок.
+#include "macros.h"			// Макросы.
+#include "pinout.h"			// Список назначенных выводов.
+#include "pressure.h"		// Управление давлением соленоидов.
+#include "critical.h"		// Критические секции.
+
+extern volatile uint32_t SystemTime;	// Время от включения из main.
+
+// Событие.
+typedef struct ACTEVENT_t {
+	uint8_t Active;		// Событие ожидает выполнения.
+	uint8_t Type;		// Тип действия.
+	uint8_t Arg;		// Параметр действия.
+	uint16_t Value;		// Значение.
+	uint32_t Ms;		// Время выполнения, мс.
+	uint8_t Tick;		// Шаг таймера 0 внутри миллисекунды.
+} ACTEVENT_t;
+
+static volatile ACTEVENT_t Queue[ACT_QUEUE_SIZE] = {};
+
+// Прототипы локальных функций.
+static uint8_t actuator_add(uint32_t Ms, uint16_t Tick, uint8_t Type, uint8_t Arg, uint16_t Value);
+static void actuator_run(uint8_t N);
+static void actuator_arm();
+
+// Событие в момент Ms + Us.
+uint8_t actuator_at(uint32_t Ms, uint16_t Us, uint8_t Type, uint8_t Arg, uint16_t Value) {
+	// Целые миллисекунды переносятся в Ms, как в actuator_after.
+	uint16_t Ticks = Us / ACT_TICK_US;
+	return actuator_add(Ms + Ticks / (OCR0A + 1), Ticks % (OCR0A + 1), Type, Arg, Value);
+}
+
+// Событие через DelayUs от текущего момента.
+uint8_t actuator_after(uint32_t DelayUs, uint8_t Type, uint8_t Arg, uint16_t Value) {
+	uint32_t Ms = 0;
+	uint8_t Tick = 0;
+	CRITICAL_BEGIN();
+		Ms = SystemTime;
+		Tick = TCNT0;
+		// Миллисекунда прошла, а прерывание еще не обработано.
+		if ((TIFR0 & (1 << OCF0A)) && Tick < OCR0A / 2) {Ms++;}
+	CRITICAL_END();
+
+	uint32_t Ticks = Tick + DelayUs / ACT_TICK_US;
+	return actuator_add(Ms + Ticks / (OCR0A + 1), Ticks % (OCR0A + 1), Type, Arg, Value);
+}
+
+// Возвращает 1, если событие еще не выполнено.
+uint8_t actuator_pending(uint8_t Id) {
+	if (Id >= ACT_QUEUE_SIZE) {return 0;}
+	return Queue[Id].Active;
+}
+
+// Отмена события.
+void actuator_cancel(uint8_t Id) {
+	if (Id >= ACT_QUEUE_SIZE) {return;}
+	Queue[Id].Active = 0;
+}
+
+// Установка давления, только пока событие Id не выполнено.
+void actuator_pressure_hold(uint8_t Id, uint8_t N, uint16_t Value) {
+	if (Id >= ACT_QUEUE_SIZE) {return;}
+	CRITICAL_BEGIN();
+		if (Queue[Id].Active) {pressure_apply(N, Value);}
+	CRITICAL_END();
+}
+
+// Вызов из прерывания таймера 0 в начале каждой миллисекунды.
+void actuator_tick() {
+	actuator_arm();
+}
+
+static uint8_t actuator_add(uint32_t Ms, uint16_t Tick, uint8_t Type, uint8_t Arg, uint16_t Value) {
+	uint8_t Id = ACT_NONE;
+	CRITICAL_BEGIN();
+		for (uint8_t i = 0; i < ACT_QUEUE_SIZE; i++) {
+			if (Queue[i].Active) {continue;}
+
+			Queue[i].Type = Type;
+			Queue[i].Arg = Arg;
+			Queue[i].Value = Value;
+			Queue[i].Ms = Ms;
+			Queue[i].Tick = MIN(Tick, OCR0A);
+			Queue[i].Active = 1;
+			Id = i;
+			break;
+		}
+		if (Id != ACT_NONE) {actuator_arm();}
+	CRITICAL_END();
+	return Id;
+}
+
+static void actuator_run(uint8_t N) {
+	Queue[N].Active = 0;
+
+	switch (Queue[N].Type) {
+		case ACT_SOLENOIDS:
+			if (Queue[N].Arg & (1 << 0)) {
+				if (Queue[N].Value & (1 << 0)) {SET_PIN_HIGH(SOLENOID_S1_PIN);}
+				else {SET_PIN_LOW(SOLENOID_S1_PIN);}
+			}
+			if (Queue[N].Arg & (1 << 1)) {
+				if (Queue[N].Value & (1 << 1)) {SET_PIN_HIGH(SOLENOID_S2_PIN);}
+				else {SET_PIN_LOW(SOLENOID_S2_PIN);}
+			}
+			if (Queue[N].Arg & (1 << 2)) {
+				if (Queue[N].Value & (1 << 2)) {SET_PIN_HIGH(SOLENOID_S3_PIN);}
+				else {SET_PIN_LOW(SOLENOID_S3_PIN);}
+			}
+			if (Queue[N].Arg & (1 << 3)) {
+				if (Queue[N].Value & (1 << 3)) {SET_PIN_HIGH(SOLENOID_S4_PIN);}
+				else {SET_PIN_LOW(SOLENOID_S4_PIN);}
+			}
+			break;
+		case ACT_PRESSURE:
+			pressure_apply(Queue[N].Arg, Queue[N].Value);
+			break;
+		case ACT_POWER_DOWN:
+			if (Queue[N].Value) {SET_PIN_HIGH(REQUEST_POWER_DOWN_PIN);}
+			else {SET_PIN_LOW(REQUEST_POWER_DOWN_PIN);}
+			break;
+	}
+}
+
+// Выполнение наступивших событий и настройка совпадения B
+// на ближайшее событие текущей миллисекунды.
+// Вызывается при запрещенных прерываниях.
+static void actuator_arm() {
+	// Миллисекунда прошла, события будут выбраны в прерывании таймера 0.
+	if (TIFR0 & (1 << OCF0A)) {return;}
+
+	uint8_t Next = 255;
+
+	for (uint8_t i = 0; i < ACT_QUEUE_SIZE; i++) {
+		if (!Queue[i].Active) {continue;}
+
+		int32_t Delta = Queue[i].Ms - SystemTime;
+		if (Delta > 0) {continue;}	// Событие в следующих миллисекундах.
+
+		// Время наступило или совпадение не успеет сработать.
+		if (Delta < 0 || Queue[i].Tick <= TCNT0 + 1) {
+			actuator_run(i);
+			continue;
+		}
+		if (Queue[i].Tick < Next) {Next = Queue[i].Tick;}
+	}
+
+	if (Next != 255) {
+		OCR0B = Next;
+		TIFR0 = (1 << OCF0B);		// Сброс флага старого совпадения.
+		TIMSK0 |= (1 << OCIE0B);
+	}
+	else {TIMSK0 &= ~(1 << OCIE0B);}
+}
+
+// Прерывание по совпадению B таймера 0.
+ISR (TIMER0_COMPB_vect) {
+	actuator_arm();
+}
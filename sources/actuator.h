@@ -0,0 +1,46 @@
+// Выполнение действий исполнительных механизмов в заданное время.
+
+#ifndef _ACTUATOR_H_
+	#define _ACTUATOR_H_
+
+	#define ACT_QUEUE_SIZE	8		// Количество событий в очереди.
+	#define ACT_NONE		255		// Нет события.
+
+	// Длительность шага таймера 0, мкс.
+	#define ACT_TICK_US		4
+
+	// Типы действий.
+	#define ACT_SOLENOIDS	1	// Шифтовые соленоиды, Arg - маска S1..S4 (биты 0..3), Value - уровни.
+	#define ACT_PRESSURE	2	// ШИМ давления, Arg - канал PRESSURE_xxx, Value - значение ШИМ.
+	#define ACT_POWER_DOWN	3	// Запрос снижения мощности, Value - уровень вывода.
+
+	uint8_t actuator_at(uint32_t Ms, uint16_t Us, uint8_t Type, uint8_t Arg, uint16_t Value);
+	uint8_t actuator_after(uint32_t DelayUs, uint8_t Type, uint8_t Arg, uint16_t Value);
+	uint8_t actuator_pending(uint8_t Id);
+	void actuator_cancel(uint8_t Id);
+	void actuator_pressure_hold(uint8_t Id, uint8_t N, uint16_t Value);
+	void actuator_tick();
+
+#endif
+
+/*
+	Событие выполняется в прерывании по совпадению B таймера 0 (шаг 4 мкс).
+	Таймеры 1 и 3 заняты ШИМ. Каналы B таймеров 4 и 5 (свободный счет, 0.5 мкс)
+	тоже свободны, но время событий задается по get_time_ms, а его отсчитывает
+	таймер 0. Канал B того же таймера не требует пересчета миллисекунд
+	(шаг 992 мкс) во время таймеров 4/5 и их расширения до 32 бит,
+	а точности 4 мкс для соленоидов и ШИМ давления достаточно.
+	В прерывании таймера 0 (каждую 1 мс) actuator_tick выбирает ближайшее
+	событие текущей миллисекунды и записывает его время в OCR0B.
+
+	actuator_at - событие в момент Ms (время get_time_ms) + Us микросекунд.
+	actuator_after - событие через DelayUs микросекунд от текущего момента.
+	Обе функции возвращают номер события или ACT_NONE при заполненной очереди.
+
+	actuator_pressure_hold - установка давления канала N, только пока событие Id
+	не выполнено. Позволяет менять давление до запланированного сброса
+	без риска перезаписать уже выполненное событие.
+
+	Пока в очереди есть событие ACT_SOLENOIDS или ACT_POWER_DOWN,
+	нельзя изменять этот порт из основного цикла (запись в PORTH/PORTJ не атомарна).
+*/
@@ -22,6 +22,8 @@ uint8_t ChPos = 0;
 uint16_t ADCValues[ADC_CHANNEL_MAX][ADC_BUFFER_SIZE] = {0};
 // Текущая позиция в буфере.
 uint8_t BufPos = 0;
+// Сумма значений в буфере.
+static uint16_t ADCSum[ADC_CHANNEL_MAX] = {0};
 
 // Инициализация АЦП.
 void adc_init() {
@@ -42,13 +44,17 @@ void adc_init() {
 
 void adc_read() {
 	// Измерения проходят в цикле, сначала все каналы в первую ячейку буфера,
-	// потом все каналы во вторую и т.д.
+	// потом все каналы во вторую и т.д. Новое значение вытесняет из суммы самое старое.
 
 	// Если бит ADSC в регистре ADCSRA сброшен,
 	// то можно запускать следующее измерение.
 	if (!(ADCSRA & (1 << ADSC))) {
 		// Считываем значение из регистров.
-		ADCValues[ChPos][BufPos] = ADCL | (ADCH << 8);
+		uint16_t Value = ADCL | (ADCH << 8);
+
+		ADCSum[ChPos] -= ADCValues[ChPos][BufPos];
+		ADCValues[ChPos][BufPos] = Value;
+		ADCSum[ChPos] += Value;
 
 		// Переходим к следующему каналу.
 		ChPos++;
@@ -79,10 +85,8 @@ void adc_read() {
 }
 
 uint16_t get_adc_value(uint8_t Channel) {
-	// Находим среднее значение.
-	uint32_t AVG = 0;
-	for (uint8_t i = 0; i < ADC_BUFFER_SIZE; i++) {AVG += ADCValues[Channel][i];}
-	return AVG >> (ADC_BUFFER_SHIFT);
+	// Среднее значение, пока окно не заполнено - пропорционально меньше.
+	return ADCSum[Channel] >> (ADC_BUFFER_SHIFT);
 }
 
 void add_channels_on(uint8_t Value) {
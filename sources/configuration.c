@@ -50,5 +50,25 @@ CFG_t CFG = {
 	.DefaultBaroPressure = 102,
 
 	.TiptronicEnable = 0,
-	.TiptronicTimer = 60 * 10
+	.TiptronicTimer = 60 * 10,
+
+	.StackMinFree = 256,
+
+	.DrumAvgTime = 20,
+	.DrumAvgMin = 4,
+	.DrumAvgMax = 32,
+	.OutputAvgTime = 20,
+	.OutputAvgMin = 4,
+	.OutputAvgMax = 32,
+
+	.TachoCylinders = 4,
+	.TachoAvgPulses = 4,
+
+	.SpeedGlitchTol = 30,
+
+	.Speed2Divider = 8,
+	.Speed2High = 4,
+
+	.SpeedFilterAlpha = 64,
+	.SpeedFilterBeta = 9
 };
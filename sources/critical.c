@@ -0,0 +1,89 @@
+#include <stdint.h>			// Коротние название int.
+#include <avr/pgmspace.h>	// Работа с флеш памятью.
+
+#include "critical.h"		// Свой заголовок.
+
+// Место вызова критической секции.
+typedef struct CRITICAL_t {
+	const char* File;		// Имя файла во флеш памяти.
+	uint16_t Line;			// Номер строки.
+	uint16_t Max;			// Максимальное время, 0.5 мкс.
+	uint16_t Calls;			// Количество вызовов.
+} CRITICAL_t;
+
+static CRITICAL_t Sites[CRITICAL_MAX_SITES];
+static uint8_t SitesCount = 0;
+static uint8_t SitesDropped = 0;	// Места, не попавшие в таблицу.
+
+// Регистрация места вызова, возвращает номер или 254 при заполненной таблице.
+uint8_t critical_register(const char* File, uint16_t Line) {
+	if (SitesCount >= CRITICAL_MAX_SITES) {
+		if (SitesDropped < UINT8_MAX) {SitesDropped++;}
+		return 254;
+	}
+
+	Sites[SitesCount].File = File;
+	Sites[SitesCount].Line = Line;
+	Sites[SitesCount].Max = 0;
+	Sites[SitesCount].Calls = 0;
+	return SitesCount++;
+}
+
+// Учет времени выполнения секции.
+void critical_stat(uint8_t N, uint16_t Time) {
+	if (N >= SitesCount) {return;}
+
+	if (Time > Sites[N].Max) {Sites[N].Max = Time;}
+	if (Sites[N].Calls < UINT16_MAX) {Sites[N].Calls++;}
+}
+
+// Сброс статистики, места вызова сохраняются.
+void critical_clear() {
+	for (uint8_t i = 0; i < SitesCount; i++) {
+		Sites[i].Max = 0;
+		Sites[i].Calls = 0;
+	}
+}
+
+uint8_t critical_get_count() {
+	return SitesCount;
+}
+
+uint8_t critical_get_dropped() {
+	return SitesDropped;
+}
+
+uint16_t critical_get_line(uint8_t N) {
+	return Sites[N].Line;
+}
+
+uint16_t critical_get_max(uint8_t N) {
+	return Sites[N].Max;
+}
+
+uint16_t critical_get_calls(uint8_t N) {
+	return Sites[N].Calls;
+}
+
+// Имя файла без пути, дополняется нулями до CRITICAL_NAME_SIZE.
+void critical_get_name(uint8_t N, char* Name) {
+	const char* File = Sites[N].File;
+
+	// Поиск начала имени после последнего разделителя.
+	const char* Start = File;
+	char C = pgm_read_byte(File);
+	while (C) {
+		if (C == '/' || C == '\\') {Start = File + 1;}
+		File++;
+		C = pgm_read_byte(File);
+	}
+
+	uint8_t i = 0;
+	C = pgm_read_byte(Start);
+	while (C && i < CRITICAL_NAME_SIZE) {
+		Name[i++] = C;
+		Start++;
+		C = pgm_read_byte(Start);
+	}
+	while (i < CRITICAL_NAME_SIZE) {Name[i++] = 0;}
+}
@@ -0,0 +1,65 @@
+// Критические секции с замером времени запрета прерываний.
+
+#ifndef _CRITICAL_H_
+	#define _CRITICAL_H_
+
+	#include <stdint.h>				// Коротние название int.
+	#include <avr/io.h>				// Названия регистров и номера бит.
+	#include <avr/interrupt.h>		// Прерывания.
+	#include <avr/pgmspace.h>		// Работа с флеш памятью.
+
+	#define CRITICAL_MAX_SITES	24		// Максимальное количество мест вызова.
+	#define CRITICAL_NAME_SIZE	12		// Длина имени файла в пакете.
+	#define CRITICAL_PAGE_SIZE	8		// Количество мест вызова в одном пакете.
+
+	// Счетчик для замера, таймер 5 (0.5 мкс).
+	// Работает без сброса, разница показаний
+	// равна длительности секции (до 32 мс).
+	#define CRITICAL_TIMER TCNT5
+
+	// Начало критической секции.
+	// Состояние прерываний сохраняется и восстанавливается в конце,
+	// поэтому секции можно вкладывать и вызывать из прерываний.
+	#define CRITICAL_BEGIN() { \
+		uint8_t CriticalSREG = SREG; \
+		cli(); \
+		static uint8_t CriticalSite = 255; \
+		if (CriticalSite == 255) { \
+			static const char CriticalFile[] PROGMEM = __FILE__; \
+			CriticalSite = critical_register(CriticalFile, __LINE__); \
+		} \
+		uint16_t CriticalStart = CRITICAL_TIMER;
+
+	// Конец критической секции.
+	#define CRITICAL_END() \
+		uint16_t CriticalTime = CRITICAL_TIMER - CriticalStart; \
+		critical_stat(CriticalSite, CriticalTime); \
+		SREG = CriticalSREG; \
+	}
+
+	uint8_t critical_register(const char* File, uint16_t Line);
+	void critical_stat(uint8_t N, uint16_t Time);
+	void critical_clear();
+
+	uint8_t critical_get_count();
+	uint8_t critical_get_dropped();
+	uint16_t critical_get_line(uint8_t N);
+	uint16_t critical_get_max(uint8_t N);
+	uint16_t critical_get_calls(uint8_t N);
+	void critical_get_name(uint8_t N, char* Name);
+
+#endif
+
+/*
+	Пример:
+		CRITICAL_BEGIN();
+			Value = ISRValue;
+		CRITICAL_END();
+
+	Для каждого места вызова (файл и строка) сохраняется
+	максимальное время запрета прерываний в единицах 0.5 мкс.
+	Места вызова регистрируются при первом выполнении,
+	после заполнения таблицы новые места не учитываются,
+	их количество возвращает critical_get_dropped.
+	При добавлении секций проверить, что оно равно 0.
+*/
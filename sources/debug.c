@@ -13,6 +13,7 @@
 #include "adc.h"			// АЦП.
 #include "gears.h"			// Фунции переключения передач.
 #include "configuration.h"	// Настройки.
+#include "pressure.h"		// Управление давлением соленоидов.
 
 // Состояние режима отладки:
 // 0 - выкл, 1 - только экран, 2 - экран + ручное управление.
@@ -262,11 +263,9 @@ static void solenoid_manual_control() {
 	TCU.SLU = 200 + (get_adc_value(4) >> 1);
 
 	// Устанавливаем ШИМ на соленоидах.
-	cli();
-		OCR1A = TCU.SLT;
-		OCR1B = TCU.SLN;
-		OCR1C = TCU.SLU;
-	sei();
+	pressure_set(PRESSURE_SLT, TCU.SLT);
+	pressure_set(PRESSURE_SLN, TCU.SLN);
+	pressure_set(PRESSURE_SLU, TCU.SLU);
 }
 
 static void debug_buttons_action() {
@@ -5,6 +5,7 @@
 #include "uart.h"			// UART.
 #include "configuration.h"	// Настройки.
 #include "eeprom.h"			// Свой заголовок.
+#include "watchdog.h"		// Сторожевой таймер.
 
 /*
 	TPS_GRID_SIZE	21 	 	42
@@ -17,6 +18,7 @@
 	1401-2047	- Адаптация		(126 + 186 = 312)
 2048-3071	- Настройки
 3072-4095	- Флаги и прочий хлам
+	3584-3599	- Запись о сбросе по сторожевому таймеру (16)
 
 Так как обновление EEPROM, при сильных изменениях, может занять много времени (максимум 3.3мс * 1000 байт),
 то небходимо на время обновления перенастраивать сторожевую собаку.
@@ -47,7 +49,7 @@ void update_eeprom_adaptation() {
 	eeprom_update_block((void*)&ADAPT, (void*) TABLES_START_BYTE_ADAPT, sizeof(ADAPT));
 	wdt_reset();
 
-	wdt_enable(WDTO_250MS);
+	watchdog_enable(WDTO_250MS);
 }
 
 // ============================ Основные таблицы ==============================
@@ -77,7 +79,7 @@ void update_eeprom_tables() {
 	update_eeprom_adaptation();
 	wdt_reset();
 
-	wdt_enable(WDTO_250MS);
+	watchdog_enable(WDTO_250MS);
 }
 
 // ============================== Таблицы АЦП =================================
@@ -99,7 +101,7 @@ void update_eeprom_adc() {
 	eeprom_update_block((void*)&ADCTBL, (void*) TABLES_START_BYTE_ADC, sizeof(ADCTBL));
 	wdt_reset();
 
-	wdt_enable(WDTO_250MS);
+	watchdog_enable(WDTO_250MS);
 }
 
 // ================ Таблицы скоростей переключения передач ====================
@@ -121,7 +123,7 @@ void update_eeprom_speed() {
 	eeprom_update_block((void*)&SPEED, (void*) TABLES_START_BYTE_SPEED, sizeof(SPEED));
 	wdt_reset();
 
-	wdt_enable(WDTO_250MS);
+	watchdog_enable(WDTO_250MS);
 }
 
 // =========================== Таблицы настроек ===============================
@@ -144,7 +146,7 @@ void update_eeprom_config() {
 	eeprom_update_block((void*)&CFG, (void*) CONFIG_START_BYTE, sizeof(CFG));
 	wdt_reset();
 
-	wdt_enable(WDTO_250MS);
+	watchdog_enable(WDTO_250MS);
 }
 
 // ====================== Вспомогательные переменные ==========================
@@ -154,5 +156,5 @@ static void read_eeprom_add_variables() {
 }
 
 void update_eeprom_add_variables() {
-	eeprom_update_dword((uint32_t*) OTHER_START_BYTE + 0, APP.RevCounter);
+	eeprom_update_dword((uint32_t*) OTHER_START_BYTE + 0, get_rev_counter());
 }
\ No newline at end of file
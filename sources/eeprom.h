@@ -5,6 +5,7 @@
 
 	#define OVERWRITE_BYTE 0xab
 	#define OVERWRITE_FIRST_BYTE_NUMBER 3072
+	#define CRASH_START_BYTE 3584		// Запись о сбросе по сторожевому таймеру.
 
 	void update_eeprom_adaptation();
 
@@ -0,0 +1,132 @@
+#include <stdint.h>			// Коротние название int.
+#include <avr/io.h>			// Названия регистров и номера бит.
+
+#include "events.h"			// Свой заголовок.
+#include "macros.h"			// Макросы.
+#include "pinout.h"			// Список назначенных выводов.
+#include "configuration.h"	// Настройки.
+#include "selector.h"		// Положение селектора АКПП.
+#include "timers.h"			// Таймеры.
+#include "ringbuf.h"		// Кольцевой буфер.
+
+// Биты дискретных входов.
+#define INPUT_BREAK			0
+#define INPUT_ENGINE_WORK	1
+#define INPUT_BUTTON_UP		2
+#define INPUT_BUTTON_DOWN	3
+
+// Писатель - прерывания, читатель - основной цикл.
+static RING_BUFFER(EVENT_t, EVENTS_QUEUE_SIZE) Queue = {};
+static volatile uint16_t Lost = 0;		// Потерянные при заполненной очереди события.
+
+static EVENT_t History[EVENTS_HISTORY_SIZE];
+static uint8_t HistoryPos = 0;
+static uint8_t HistoryCount = 0;
+
+// Прототипы локальных функций.
+static uint8_t get_inputs_byte();
+static void inputs_event(uint8_t Changed, uint8_t State, uint8_t Bit, uint8_t Type);
+
+// Добавление события в очередь, только из прерываний.
+void events_push(uint8_t Type, uint8_t Data) {
+	if (RING_FULL(Queue)) {
+		if (Lost < UINT16_MAX) {Lost++;}
+		return;
+	}
+
+	EVENT_t Event;
+	Event.Type = Type;
+	Event.Data = Data;
+	get_timestamp(&Event.Time, &Event.Sub);
+	RING_PUSH(Queue, Event);
+}
+
+// Получение события из очереди, возвращает 0 если очередь пуста.
+uint8_t events_get(EVENT_t* Event) {
+	if (RING_EMPTY(Queue)) {return 0;}
+
+	*Event = RING_PEEK(Queue, 0);
+	RING_COMMIT(Queue, 1);
+
+	History[HistoryPos] = *Event;
+	HistoryPos = (HistoryPos + 1) % EVENTS_HISTORY_SIZE;
+	if (HistoryCount < EVENTS_HISTORY_SIZE) {HistoryCount++;}
+	return 1;
+}
+
+// Опрос входов, вызов из прерывания таймера 0 каждую 1 мс.
+void events_poll() {
+	static uint8_t SelectorLast = 0;
+	static uint8_t SelectorState = 0;
+	static uint8_t SelectorTimer = 0;
+
+	static uint8_t InputsLast = 0;
+	static uint8_t InputsState = 0;
+	static uint8_t InputsTimer = 0;
+
+	uint8_t Selector = get_selector_byte();
+	if (Selector != SelectorLast) {
+		SelectorLast = Selector;
+		SelectorTimer = 0;
+	}
+	else if (SelectorTimer < EVENTS_DEBOUNCE) {
+		SelectorTimer++;
+		if (SelectorTimer == EVENTS_DEBOUNCE && Selector != SelectorState) {
+			SelectorState = Selector;
+			events_push(EVENT_SELECTOR, Selector);
+		}
+	}
+
+	uint8_t Inputs = get_inputs_byte();
+	if (Inputs != InputsLast) {
+		InputsLast = Inputs;
+		InputsTimer = 0;
+	}
+	else if (InputsTimer < EVENTS_DEBOUNCE) {
+		InputsTimer++;
+		if (InputsTimer == EVENTS_DEBOUNCE && Inputs != InputsState) {
+			uint8_t Changed = Inputs ^ InputsState;
+			InputsState = Inputs;
+
+			inputs_event(Changed, Inputs, INPUT_BREAK, EVENT_BREAK);
+			inputs_event(Changed, Inputs, INPUT_ENGINE_WORK, EVENT_ENGINE_WORK);
+			inputs_event(Changed, Inputs, INPUT_BUTTON_UP, EVENT_BUTTON_UP);
+			inputs_event(Changed, Inputs, INPUT_BUTTON_DOWN, EVENT_BUTTON_DOWN);
+		}
+	}
+}
+
+uint8_t events_get_history_count() {
+	return HistoryCount;
+}
+
+// Событие из истории, 0 - самое старое.
+EVENT_t* events_get_history(uint8_t N) {
+	uint8_t Pos = (HistoryPos + EVENTS_HISTORY_SIZE - HistoryCount + N) % EVENTS_HISTORY_SIZE;
+	return &History[Pos];
+}
+
+uint16_t events_get_lost() {
+	return Lost;
+}
+
+// Состояние дискретных входов, 1 - активный уровень.
+static uint8_t get_inputs_byte() {
+	uint8_t Val = 0;
+
+	#ifdef INVERSE_BREAK_PEDAL
+		if (!PIN_READ(BREAK_PEDAL_PIN)) {BITSET(Val, INPUT_BREAK);}
+	#else
+		if (PIN_READ(BREAK_PEDAL_PIN)) {BITSET(Val, INPUT_BREAK);}
+	#endif
+	if (PIN_READ(ENGINE_WORK_PIN)) {BITSET(Val, INPUT_ENGINE_WORK);}
+	if (!PIN_READ(TIP_GEAR_UP_PIN)) {BITSET(Val, INPUT_BUTTON_UP);}
+	if (!PIN_READ(TIP_GEAR_DOWN_PIN)) {BITSET(Val, INPUT_BUTTON_DOWN);}
+
+	return Val;
+}
+
+static void inputs_event(uint8_t Changed, uint8_t State, uint8_t Bit, uint8_t Type) {
+	if (!(Changed & (1 << Bit))) {return;}
+	events_push(Type, (State >> Bit) & 1);
+}
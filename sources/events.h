@@ -0,0 +1,52 @@
+// Очередь событий от прерываний к основному циклу.
+
+#ifndef _EVENTS_H_
+	#define _EVENTS_H_
+
+	#define EVENTS_QUEUE_SIZE	16		// Размер очереди, степень двойки.
+	#define EVENTS_HISTORY_SIZE	16		// Количество событий в истории.
+	#define EVENTS_DEBOUNCE		5		// Время стабильного состояния входа, мс.
+
+	// Типы событий.
+	#define EVENT_SELECTOR			1	// Положение селектора, Data - байт выводов селектора.
+	#define EVENT_BREAK				2	// Педаль тормоза, Data - состояние.
+	#define EVENT_ENGINE_WORK		3	// Сигнал работы двигателя, Data - состояние.
+	#define EVENT_BUTTON_UP			4	// Кнопка типтроника вверх, Data - 1 нажата.
+	#define EVENT_BUTTON_DOWN		5	// Кнопка типтроника вниз, Data - 1 нажата.
+	// 6 - не используется.
+	#define EVENT_DRUM_TIMEOUT		7	// Нет сигнала датчика корзины овердрайва.
+	#define EVENT_OUTPUT_TIMEOUT	8	// Нет сигнала датчика выходного вала.
+
+	// Событие.
+	typedef struct EVENT_t {
+		uint8_t Type;		// Тип события.
+		uint8_t Data;		// Значение.
+		uint8_t Sub;		// Доля миллисекунды в единицах 10 мкс (0..99), см. get_timestamp.
+		uint32_t Time;		// Время события, мс.
+	} EVENT_t;
+
+	void events_push(uint8_t Type, uint8_t Data);
+	uint8_t events_get(EVENT_t* Event);
+	void events_poll();
+
+	uint8_t events_get_history_count();
+	EVENT_t* events_get_history(uint8_t N);
+	uint16_t events_get_lost();
+
+#endif
+
+/*
+	Очередь с одним писателем и одним читателем без запрета прерываний.
+	Писатель - прерывания (вложенных прерываний нет, поэтому писатель один),
+	читатель - основной цикл.
+	events_push можно вызывать только из обработчиков прерываний.
+
+	events_poll вызывается в прерывании таймера 0 (1 мс),
+	опрашивает селектор, педаль тормоза, сигнал работы двигателя и кнопки
+	и добавляет событие после EVENTS_DEBOUNCE мс стабильного состояния.
+	По отпусканию кнопки типтроника состояние кнопок обновляется сразу
+	и запускается обработка переключений, без ожидания периода задач.
+
+	Полученные события сохраняются в истории,
+	история отправляется по команде GET_EVENTS_COMMAND.
+*/
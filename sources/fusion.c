@@ -0,0 +1,114 @@
+#include <stdint.h>			// Коротние название int.
+
+#include "fusion.h"			// Свой заголовок.
+#include "tcudata.h"		// Расчет и хранение всех необходимых параметров.
+#include "configuration.h"	// Настройки.
+#include "ratio.h"			// Передаточное число и фазы переключения.
+#include "macros.h"			// Макросы.
+
+// Отклонение замера от прогноза, при котором фильтр сбрасывается на замер.
+#define FUSION_RESET_RPM 300
+// Минимальные обороты выходного вала для объединения валов.
+#define FUSION_MIN_OUTPUT_RPM 150
+// Шагов по 5 мс в 100 мс, для ускорения в об/мин за 100 мс.
+#define FUSION_STEPS_100MS 20
+// Допустимые коэффициенты фильтра, при больших фильтр не сглаживает
+// или становится неустойчивым. 255 - не заданное значение из старой EEPROM.
+#define FUSION_ALPHA_MAX 192
+#define FUSION_BETA_MAX 64
+
+// Состояние фильтра одного вала, обороты и ускорение x256.
+typedef struct FILTER_t {
+	int32_t Speed;		// Обороты.
+	int32_t Accel;		// Изменение оборотов за шаг 5 мс.
+} FILTER_t;
+
+static FILTER_t Drum = {0};
+static FILTER_t Output = {0};
+static uint8_t Locked = 0;
+
+// Прототипы локальных функций.
+static void filter_step(FILTER_t* Filter, uint16_t Value);
+static void filter_couple(uint16_t Ratio);
+static uint16_t filter_rpm(FILTER_t* Filter);
+static int16_t filter_delta(FILTER_t* Filter);
+
+// Фильтрация оборотов валов, вызов каждые 5 мс.
+void fusion_update() {
+	// Связь валов проверяется по прошлой оценке, до нового замера.
+	uint16_t Ratio = 0;
+	Locked = 0;
+	if (!TCU.GearChange && TCU.Gear >= 1 && TCU.Gear <= 4) {Ratio = ratio_gear(TCU.Gear);}
+	if (Ratio && Drum.Speed && filter_rpm(&Output) >= FUSION_MIN_OUTPUT_RPM) {
+		int16_t Calc = ((uint32_t) filter_rpm(&Output) * Ratio) >> 10;
+		int16_t Delta = (int16_t) filter_rpm(&Drum) - Calc;
+		if (ABS(Delta) <= CFG.MaxSlipRPM) {Locked = 1;}
+	}
+
+	filter_step(&Drum, TCU.DrumRPM);
+	filter_step(&Output, TCU.OutputRPM);
+	if (Locked) {filter_couple(Ratio);}
+
+	TCU.DrumRPM = filter_rpm(&Drum);
+	TCU.OutputRPM = filter_rpm(&Output);
+	TCU.DrumRPMDelta = filter_delta(&Drum);
+	TCU.OutputRPMDelta = filter_delta(&Output);
+}
+
+uint8_t fusion_enabled() {
+	if (!CFG.SpeedFilterAlpha || CFG.SpeedFilterAlpha > FUSION_ALPHA_MAX) {return 0;}
+	if (CFG.SpeedFilterBeta > FUSION_BETA_MAX) {return 0;}
+	return 1;
+}
+
+uint8_t fusion_locked() {
+	return Locked;
+}
+
+// Шаг альфа-бета фильтра.
+static void filter_step(FILTER_t* Filter, uint16_t Value) {
+	int32_t Measure = (int32_t) Value << 8;
+
+	// Нет сигнала, обороты сразу 0.
+	if (!Value) {
+		Filter->Speed = 0;
+		Filter->Accel = 0;
+		return;
+	}
+
+	// Прогноз по ускорению и отклонение замера от прогноза.
+	int32_t Predict = Filter->Speed + Filter->Accel;
+	int32_t Residual = Measure - Predict;
+
+	// Появление сигнала или резкий скачок, начинаем с замера.
+	if (!Filter->Speed || ABS(Residual) > ((int32_t) FUSION_RESET_RPM << 8)) {
+		Filter->Speed = Measure;
+		Filter->Accel = 0;
+		return;
+	}
+
+	Filter->Speed = Predict + ((Residual * CFG.SpeedFilterAlpha) >> 8);
+	Filter->Accel += (Residual * CFG.SpeedFilterBeta) >> 8;
+}
+
+// Объединение ускорений валов на включенной передаче.
+static void filter_couple(uint16_t Ratio) {
+	// Корзина вращается в Ratio раз быстрее и имеет больше зубов,
+	// поэтому ее ускорение точнее, вес 3/4.
+	int32_t FromDrum = (Drum.Accel * 1024) / Ratio;
+	int32_t Accel = (Output.Accel + FromDrum * 3) >> 2;
+
+	Output.Accel = Accel;
+	Drum.Accel = (Accel * Ratio) >> 10;
+}
+
+static uint16_t filter_rpm(FILTER_t* Filter) {
+	if (Filter->Speed <= 0) {return 0;}
+	return (Filter->Speed + 128) >> 8;
+}
+
+// Ускорение в об/мин за 100 мс.
+static int16_t filter_delta(FILTER_t* Filter) {
+	int32_t Delta = (Filter->Accel * FUSION_STEPS_100MS) >> 8;
+	return CONSTRAIN(Delta, -32000, 32000);
+}
@@ -0,0 +1,28 @@
+// Совместная фильтрация оборотов корзины овердрайва и выходного вала.
+
+#ifndef _FUSION_H_
+	#define _FUSION_H_
+
+	void fusion_update();
+	uint8_t fusion_enabled();
+	uint8_t fusion_locked();
+
+#endif
+
+/*
+	fusion_update вызывается после расчета оборотов по датчикам (5 мс),
+	берет из TCU.DrumRPM и TCU.OutputRPM сырые значения и заменяет их
+	отфильтрованными, в TCU.DrumRPMDelta и TCU.OutputRPMDelta записывает ускорение.
+
+	Для каждого вала работает альфа-бета фильтр (установившийся фильтр Калмана
+	для модели с постоянным ускорением). На включенной передаче 1-4 валы
+	связаны передаточным числом, ускорения обоих валов объединяются в одно.
+	Обороты валов остаются независимыми, чтобы проскальзывание было видно.
+	Во время переключения, на 5 передаче и при расхождении оборотов
+	больше CFG.MaxSlipRPM фильтры работают раздельно.
+
+	fusion_enabled - 1, если коэффициенты заданы и допустимы
+	(Alpha 1-192, Beta до 64), иначе фильтр выключен.
+
+	fusion_locked - 1, если на последнем шаге ускорения были объединены.
+*/
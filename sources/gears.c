@@ -10,10 +10,35 @@
 #include "configuration.h"	// Настройки.
 #include "spdsens.h"		// Датчики скорости валов.
 #include "buttons.h"		// Кнопки.
+#include "timers.h"			// Таймеры.
+#include "pressure.h"		// Управление давлением соленоидов.
+#include "actuator.h"		// Действия исполнительных механизмов по времени.
+#include "ratio.h"			// Передаточное число и фазы переключения.
 
 extern uint16_t WaitTimer;			// Таймер ожидания из main.
 uint16_t GearChangeStep = 100;		// Шаг времени на переключение передачи.
 
+static void (*GearChangeProcess)() = 0;	// Текущий процесс переключения.
+static uint8_t GearChangeStage = 0;		// Этап процесса переключения.
+static uint32_t GearChangeStartTime = 0;	// Время запуска процесса, мс.
+
+// Переменные процесса переключения, сохраняются между этапами.
+static int8_t ShiftPDR = 0;				// Состояние запроса снижения мощности.
+static uint8_t ShiftPDRStep = 0;		// Шаг начала запроса снижения мощности.
+static uint16_t ShiftPDRTime = 0;		// Для фиксации времени работы PDR.
+static int8_t ShiftAdaptation = 0;		// Флаг применения адаптации.
+static uint16_t ShiftInitLoad = 0;		// Значение ДПДЗ c бароккорекцией в начале цикла.
+static uint8_t ShiftSLUDelay = 0;		// Пауза повышения давления после начала переключения.
+static uint8_t ShiftSetSLN = 0;			// Флаг установки давления SLN.
+static uint16_t ShiftTestTimer = 0;		// Таймер для проверки начала переключения.
+static int8_t ShiftAdd = 0;				// Добавка к значению SLN из таблицы.
+static int16_t ShiftDeltaNext = 0;		// Отличие оборотов от следующей передачи.
+static uint8_t ShiftWaitStage = 0;		// Этап ожидания завершения переключения.
+static int16_t ShiftMaxDeltaRPM = 0;	// Максимальная разница оборотов при включении второй.
+static uint8_t ShiftSLUEvent = ACT_NONE;	// Запланированный сброс давления SLU.
+static uint8_t ShiftSLNEvent = ACT_NONE;	// Запланированное включение давления SLN.
+static int16_t InitDrumRPMDelta = 0;	// Дельта оборотов, при котором началось включение второй.
+
 #define GEAR_2_MAX_STEP 20			// Количество шагов при включении второй передачи.
 #define GEAR_CHANGE_MAX_TIME 2500	// Максимальное время переключения передачи.
 
@@ -24,7 +49,6 @@ int8_t MaxGear[] = {0, 0, -1, 0, 5, 4, 3, 2, 1, 0, 5};
 int8_t MinGear[] = {0, 0, -1, 0, 1, 1, 1, 2, 1, 0, 1};
 
 // Прототипы функций.
-void loop_main(uint8_t Wait);		// Прототип функций из main.c.
 void glock_control(uint8_t Timer);	// Прототип функций из tculogic.c.
 
 static void gear_change_1_2();
@@ -37,15 +61,24 @@ static void gear_change_4_3();
 static void gear_change_3_2();
 static void gear_change_2_1();
 
+static void gear2_engage();
+static void gear2_engage_step_timer();
+static void slu_gear2_step(uint8_t Delay);
+static void gear_change_pause();
+
 static void gear_up();
 static void gear_down();
 
 static void set_gear_change_delays();
-static void loop_wait(uint16_t Delay);
 
 static uint8_t rpm_after_ok(uint8_t Shift);
 
-static void gear_change_wait(int8_t GearChange, int8_t Add);
+static void gear_change_start(void (*Process)());
+static void gear_change_finish();
+static void gear_change_cancel();
+
+static void gear_change_wait_start(int8_t Add);
+static uint8_t gear_change_wait();
 
 //static void set_slt(uint8_t Value);
 static void set_sln(uint16_t Value);
@@ -106,337 +139,557 @@ void disable_gear_r() {
 
 //=========================== Переключения вверх ==============================
 static void gear_change_1_2() {
-	TCU.GearChange = 1;
+	switch (GearChangeStage) {
+		case 0:
+			TCU.GearChange = 1;
 
-	set_solenoids(2);					// Установка шифтовых соленоидов.
-	SET_PIN_HIGH(SOLENOID_S3_PIN);		// Включаем систему "Clutch to Clutch".
+			set_solenoids(2);					// Установка шифтовых соленоидов.
+			SET_PIN_HIGH(SOLENOID_S3_PIN);		// Включаем систему "Clutch to Clutch".
 
-	uint16_t NextSLU = get_slu_pressure_gear2();
-	set_slu(NextSLU);
+			set_slu(get_slu_pressure_gear2());
 
-	TCU.GearChangeTPS = TCU.Load;
-	TCU.GearChangeSLU = TCU.SLU;
+			TCU.GearChangeTPS = TCU.Load;
+			TCU.GearChangeSLU = TCU.SLU;
 
-	set_sln(CFG.MinPressureSLN);
+			set_sln(CFG.MinPressureSLN);
 
-	TCU.GearStep = 0;		// Шаг процесса включения передачи.
-	uint8_t PDR = 0;		// Состояние процесса запроса снижения мощности.
-	uint8_t PDRStep = 0;	// Для фиксации времени работы PDR.
-	TCU.LastStep = GEAR_2_MAX_STEP;	// Номер последнего шага переключения.
-	uint8_t SLUDelay = 0;	// Пауза повышения давления после начала переключения.
-	int8_t Adaptation = 0;	// Флаг применения адаптации.
-	TCU.LastPDRTime = 0;
-	if (TCU.Load > CFG.PowerDownMaxTPS) {PDR = -1;}
-	
-	uint8_t InitLoad = TCU.Load;	// Значение ДПДЗ c бароккорекцией в начале цикла.
-	while (TCU.GearStep < GEAR_2_MAX_STEP) {
-		set_gear_change_delays();		// Установка длительности 1 шага переключения от ДПДЗ.
-		WaitTimer = GearChangeStep;		// Устанавливаем время ожидания.
-		while (WaitTimer) {
-			loop_main(1);
+			TCU.GearStep = 0;		// Шаг процесса включения передачи.
+			ShiftPDR = 0;
+			ShiftPDRStep = 0;
+			TCU.LastStep = GEAR_2_MAX_STEP;	// Номер последнего шага переключения.
+			ShiftSLUDelay = 0;
+			ShiftAdaptation = 0;
+			TCU.LastPDRTime = 0;
+			if (TCU.Load > CFG.PowerDownMaxTPS) {ShiftPDR = -1;}
+			ShiftInitLoad = TCU.Load;
 
+			set_gear_change_delays();		// Установка длительности 1 шага переключения от ДПДЗ.
+			WaitTimer = GearChangeStep;		// Устанавливаем время ожидания.
+			GearChangeStage = 1;
+			break;
+		case 1:
 			// Отключение передачи при сбросе газа.
 			if (TCU.InstTPS <= CFG.IdleTPSLimit && TCU.ATMode != 6 && TCU.ATMode != 7) {
 				set_solenoids(1);
 				set_slu(CFG.MinPressureSLU);
 				set_sln(CFG.IdlePressureSLN);
-				loop_wait(200);
-				TCU.Gear = 2;
-				TCU.Gear2State = 0;
-				TCU.GearChange = 0;
-				return;
+				SET_PIN_LOW(REQUEST_POWER_DOWN_PIN);
+				WaitTimer = 200;
+				GearChangeStage = 2;
+				break;
 			}
 
-			NextSLU = get_slu_pressure_gear2() + TCU.GearStep * 2 - SLUDelay;
-			set_slu(NextSLU);
+			slu_gear2_step(ShiftSLUDelay);
 
-			if (!PDR && rpm_delta(1) < -50) {			// Переключение началось.
-				PDR = 1;
-				SLUDelay = 3;
-				PDRStep = TCU.GearStep;
+			if (!ShiftPDR && ratio_phase_reached(PHASE_INERTIA)) {		// Переключение началось.
+				ShiftPDR = 1;
+				ShiftSLUDelay = 3;
+				ShiftPDRStep = TCU.GearStep;
 				SET_PIN_HIGH(REQUEST_POWER_DOWN_PIN);	// Запрашиваем снижение мощности.
 			}
-		}
-		TCU.GearStep++;
+			if (WaitTimer) {break;}
 
-		// Обороты валов выровнялись.
-		if (ABS(rpm_delta(2)) < 35) {
-			if (PDR == 1) {TCU.LastPDRTime = (TCU.GearStep - PDRStep) * GearChangeStep;}
-			SET_PIN_LOW(REQUEST_POWER_DOWN_PIN);
+			TCU.GearStep++;
 
-			if (TCU.LastStep == GEAR_2_MAX_STEP) {TCU.LastStep = TCU.GearStep;}
+			// Обороты валов выровнялись.
+			if (ABS(rpm_delta(2)) < 35) {
+				if (ShiftPDR == 1) {TCU.LastPDRTime = (TCU.GearStep - ShiftPDRStep) * GearChangeStep;}
+				SET_PIN_LOW(REQUEST_POWER_DOWN_PIN);
 
-			if (TCU.GearStep < 14 && !Adaptation) {
-				// Передача включилась слишком рано,
-				// снижаем давление на 1 единицу.
-				Adaptation = -1;
-				save_gear2_slu_adaptation(-1, (InitLoad + TCU.Load) / 2);
-			}
-		}
-		if (TCU.GearStep > 16 && rpm_delta(2) > 35 && !Adaptation) {
-			// Передача включилась слишком поздно,
-			// повышаем давление на 1 единицу.
-			Adaptation = 1;
-			save_gear2_slu_adaptation(1, (InitLoad + TCU.Load) / 2);
-		}
-	}
+				if (TCU.LastStep == GEAR_2_MAX_STEP) {TCU.LastStep = TCU.GearStep;}
 
-	SET_PIN_LOW(SOLENOID_S3_PIN);
-	set_sln(CFG.IdlePressureSLN);
-	SET_PIN_LOW(REQUEST_POWER_DOWN_PIN);
-	
-	TCU.Gear = 2;
-	TCU.Gear2State = 8;
-	TCU.GearChange = 0;
-}
+				if (TCU.GearStep < 14 && !ShiftAdaptation) {
+					// Передача включилась слишком рано,
+					// снижаем давление на 1 единицу.
+					ShiftAdaptation = -1;
+					save_gear2_slu_adaptation(-1, (ShiftInitLoad + TCU.Load) / 2);
+				}
+			}
+			if (TCU.GearStep > 16 && rpm_delta(2) > 35 && !ShiftAdaptation) {
+				// Передача включилась слишком поздно,
+				// повышаем давление на 1 единицу.
+				ShiftAdaptation = 1;
+				save_gear2_slu_adaptation(1, (ShiftInitLoad + TCU.Load) / 2);
+			}
 
-static void gear_change_2_3() {
-	// Не включать третью при недовключенной второй передаче.
-	if (TCU.Gear2State != 8 && TCU.InstTPS > CFG.IdleTPSLimit && !TCU.ManualModeTimer) {return;}
-	TCU.GearChange = 1;
+			if (TCU.GearStep < GEAR_2_MAX_STEP) {
+				set_gear_change_delays();
+				WaitTimer = GearChangeStep;
+				break;
+			}
 
-	// Ручное включение третьей передачи при выключенной второй.
-	if (TCU.Gear2State == 0) {
-		set_slu(CFG.MinPressureSLU);
-		set_sln(get_sln_pressure_gear3());
-		loop_wait(GearChangeStep * 5);
+			SET_PIN_LOW(SOLENOID_S3_PIN);
+			set_sln(CFG.IdlePressureSLN);
+			SET_PIN_LOW(REQUEST_POWER_DOWN_PIN);
 
-		set_solenoids(3);
-		loop_wait(GearChangeStep * 2);
-		set_sln(CFG.IdlePressureSLN);
+			TCU.Gear = 2;
+			TCU.Gear2State = 8;
+			gear_change_finish();
+			break;
+		case 2:
+			// Пауза после отключения передачи при сбросе газа.
+			if (WaitTimer) {break;}
 
-		TCU.Gear = 3;
-		TCU.GearChange = 0;
-		return;
+			TCU.Gear = 2;
+			TCU.Gear2State = 0;
+			gear_change_finish();
+			break;
 	}
+}
 
-	set_solenoids(3);		// Установка шифтовых соленоидов.
+static void gear_change_2_3() {
+	switch (GearChangeStage) {
+		case 0:
+			// Не включать третью при недовключенной второй передаче.
+			if (TCU.Gear2State != 8 && TCU.InstTPS > CFG.IdleTPSLimit && !TCU.ManualModeTimer) {
+				gear_change_finish();
+				break;
+			}
+			TCU.GearChange = 1;
 
-	set_slu(get_slu_pressure_gear3());
-	TCU.GearChangeTPS = TCU.Load;
-	TCU.GearChangeSLU = TCU.SLU;
+			// Ручное включение третьей передачи при выключенной второй.
+			if (TCU.Gear2State == 0) {
+				set_slu(CFG.MinPressureSLU);
+				set_sln(get_sln_pressure_gear3());
+				WaitTimer = GearChangeStep * 5;
+				GearChangeStage = 3;
+				break;
+			}
 
-	set_sln(CFG.IdlePressureSLN);
+			set_solenoids(3);		// Установка шифтовых соленоидов.
 
-	WaitTimer = get_gear3_slu_delay();				// Время удержания давления SLU.
-	int16_t SLNOffset = get_gear3_sln_offset();		// Смещение времени включения SLN.
-	uint8_t SetSLN = 0;		// Флаг установки давления SLN
-	int8_t Adaptation = 0;	// Флаг применения адаптации.
+			set_slu(get_slu_pressure_gear3());
+			TCU.GearChangeTPS = TCU.Load;
+			TCU.GearChangeSLU = TCU.SLU;
 
-	uint8_t PDR = 0;		// Флаг применения запроса снижения мощности.
-	uint16_t PDRTime = 0;	// Длительность применения снижения мощности.
+			set_sln(CFG.IdlePressureSLN);
 
-	// Ждем начало включения B2.
-	uint8_t InitLoad = TCU.Load;	// Значение ДПДЗ с барокоррекцией в начале цикла.
-	while (WaitTimer) {
-		loop_main(1);
+			WaitTimer = get_gear3_slu_delay();	// Время удержания давления SLU.
+			ShiftSetSLN = 0;
 
-		// Давление SLU включения третьей передачи
-		set_slu(get_slu_pressure_gear3());
-		
-		if (!SetSLN) {
-			SLNOffset = get_gear3_sln_offset();
-		 	if (WaitTimer + SLNOffset < 5) {SetSLN = 1;}	// Пересечение SNL и SLU при SLNOffset < 0.
-		}
-		else {set_sln(get_sln_pressure_gear3());}
-	}
-	set_slu(CFG.MinPressureSLU);		// Убираем давление SLU.
+			// Сброс SLU и пересечение с SLN выполняются по таймеру с точностью 4 мкс.
+			ShiftSLUEvent = actuator_after((uint32_t) WaitTimer * 1000, ACT_PRESSURE, PRESSURE_SLU, CFG.MinPressureSLU);
+			ShiftSLNEvent = ACT_NONE;
+			if (get_gear3_sln_offset() < 5) {
+				int16_t SLNTime = WaitTimer + get_gear3_sln_offset() - 5;
+				if (SLNTime < 0) {SLNTime = 0;}
+				ShiftSLNEvent = actuator_after((uint32_t) SLNTime * 1000, ACT_PRESSURE, PRESSURE_SLN, get_sln_pressure_gear3());
+			}
+			ShiftAdaptation = 0;
+			ShiftPDR = 0;
+			ShiftPDRTime = 0;
+			ShiftInitLoad = TCU.Load;
+			GearChangeStage = 1;
+			break;
+		case 1:
+			// Ждем начало включения B2.
+			// Давление SLU включения третьей передачи до запланированного сброса.
+			if (ShiftSLUEvent != ACT_NONE) {actuator_pressure_hold(ShiftSLUEvent, PRESSURE_SLU, get_slu_pressure_gear3());}
+			else {set_slu(get_slu_pressure_gear3());}
+
+			if (!ShiftSetSLN) {
+				if (ShiftSLNEvent != ACT_NONE) {
+					if (!actuator_pending(ShiftSLNEvent)) {ShiftSetSLN = 1;}
+				}
+				else {
+					int16_t SLNOffset = get_gear3_sln_offset();		// Смещение времени включения SLN.
+					if (WaitTimer + SLNOffset < 5) {ShiftSetSLN = 1;}	// Пересечение SNL и SLU при SLNOffset < 0.
+				}
+			}
+			else {set_sln(get_sln_pressure_gear3());}
+			if (WaitTimer || actuator_pending(ShiftSLUEvent)) {break;}
+			ShiftSLUEvent = ACT_NONE;
+			ShiftSLNEvent = ACT_NONE;
 
-	if (TCU.Load > CFG.PowerDownMaxTPS) {PDR = -1;}
+			set_slu(CFG.MinPressureSLU);		// Убираем давление SLU.
+			if (TCU.Load > CFG.PowerDownMaxTPS) {ShiftPDR = -1;}
 
-	WaitTimer = 1500;						// Время ожидания завершения переключения.
-	uint16_t GearTestTimer = WaitTimer;		// Таймер для проверки начала переключения.
-	// Ждем включения третьей передачи.
-	while (WaitTimer && rpm_delta(3) > 35) {
-		int16_t Delta2 = rpm_delta(2);
+			WaitTimer = 1500;					// Время ожидания завершения переключения.
+			ShiftTestTimer = WaitTimer;			// Таймер для проверки начала переключения.
+			GearChangeStage = 2;
+			break;
+		case 2:
+			// Ждем включения третьей передачи.
+			if (WaitTimer && rpm_delta(3) > 35) {
+				int16_t Delta2 = rpm_delta(2);
+
+				// Проверка на закусывание передачи 2 и 3.
+				// Через 40 мс после сброса давления SLU должно начаться изменение передаточного числа.
+				if (ShiftTestTimer && !ShiftAdaptation && ShiftTestTimer - WaitTimer >= 40) {
+					ShiftTestTimer = 0;
+					if (Delta2 > -5) {ShiftAdaptation = -1;}	// Произошло закусывание (?).
+				}
 
-		loop_main(1);
+				if (!ShiftPDR && ratio_phase_reached(PHASE_INERTIA)) {		// Переключение началось.
+					ShiftPDR = 1;
+					ShiftPDRTime = WaitTimer;
+					SET_PIN_HIGH(REQUEST_POWER_DOWN_PIN);
+				}
 
-		// Проверка на закусывание передачи 2 и 3.
-		// Через 40 мс после сброса давления SLU должно начаться изменение передаточного числа.
-		if (GearTestTimer && !Adaptation && GearTestTimer - WaitTimer >= 40) {
-			GearTestTimer = 0;
-			if (Delta2 > -5) {Adaptation = -1;}	// Произошло закусывание (?).
-		}
-		
-		if (!PDR && Delta2 < -50) {		// Переключение началось.
-			PDR = 1;
-			PDRTime = WaitTimer;
-			SET_PIN_HIGH(REQUEST_POWER_DOWN_PIN);
-		}
+				if (!ShiftSetSLN) {
+					int16_t SLNOffset = get_gear3_sln_offset();
+					if (1500 - WaitTimer > SLNOffset) {ShiftSetSLN = 1;}	// Задержка SLN при SLNOffset > 0.
+				}
+				else {set_sln(get_sln_pressure_gear3());}					// Устанавливаем давление SLN.
 
-		if (!SetSLN) {
-			SLNOffset = get_gear3_sln_offset();
-		 	if (1500 - WaitTimer > SLNOffset) {SetSLN = 1;}		// Задержка SLN при SLNOffset > 0.
-		}
-		else {set_sln(get_sln_pressure_gear3());}				// Устанавливаем давление SLN.
+				if (ShiftAdaptation != 1 && Delta2 > 30) {
+					// Проскальзывание второй передачи.
+					// Выключение SLU произошло слишком рано.
+					ShiftAdaptation = 1;
+				}
+				break;
+			}
 
-		if (Adaptation != 1 && Delta2 > 30) {
-			// Проскальзывание второй передачи.
-			// Выключение SLU произошло слишком рано.
-			Adaptation = 1;
-		}
-	}
+			TCU.GearChangeSLN = TCU.SLN;
+			set_sln(CFG.IdlePressureSLN);
 
-	TCU.GearChangeSLN = TCU.SLN;
-	set_sln(CFG.IdlePressureSLN);
+			SET_PIN_LOW(REQUEST_POWER_DOWN_PIN);
+			if (ShiftPDR == 1) {TCU.LastPDRTime = ShiftPDRTime - WaitTimer;}
 
-	SET_PIN_LOW(REQUEST_POWER_DOWN_PIN);
-	if (PDR == 1) {TCU.LastPDRTime = PDRTime - WaitTimer;}
+			// Включаем торможение двигателем в режиме "3".
+			if (TCU.ATMode == 6) {SET_PIN_HIGH(SOLENOID_S3_PIN);}
+
+			// Применение адаптации.
+			if (ShiftAdaptation) {save_gear3_slu_adaptation(ShiftAdaptation, (ShiftInitLoad + TCU.Load) / 2);}
 
-	// Включаем торможение двигателем в режиме "3".
-	if (TCU.ATMode == 6) {SET_PIN_HIGH(SOLENOID_S3_PIN);}
+			TCU.Gear = 3;
+			TCU.Gear2State = 0;
+			gear_change_finish();
+			break;
+		case 3:
+			// Ручное включение, ждем подготовку давления SLN.
+			if (WaitTimer) {break;}
 
-	// Применение адаптации.
-	if (Adaptation) {save_gear3_slu_adaptation(Adaptation, (InitLoad + TCU.Load) / 2);}
+			set_solenoids(3);
+			WaitTimer = GearChangeStep * 2;
+			GearChangeStage = 4;
+			break;
+		case 4:
+			if (WaitTimer) {break;}
 
-	TCU.Gear = 3;
-	TCU.Gear2State = 0;
-	TCU.GearChange = 0;
+			set_sln(CFG.IdlePressureSLN);
+			TCU.Gear = 3;
+			gear_change_finish();
+			break;
+	}
 }
 
 static void gear_change_3_4() {
-	TCU.GearChange = 1;
+	switch (GearChangeStage) {
+		case 0:
+			TCU.GearChange = 1;
 
-	set_sln(get_sln_pressure());
-	loop_wait(GearChangeStep * 3);
-	set_solenoids(4);		// Установка шифтовых соленоидов.
+			set_sln(get_sln_pressure());
+			WaitTimer = GearChangeStep * 3;
+			GearChangeStage = 1;
+			break;
+		case 1:
+			if (WaitTimer) {break;}
+
+			set_solenoids(4);		// Установка шифтовых соленоидов.
 
-	TCU.GearChangeTPS = TCU.Load;
-	TCU.GearChangeSLT = TCU.SLT;
-	TCU.GearChangeSLN = TCU.SLN;
-	
-	gear_change_wait(1, 0);
+			TCU.GearChangeTPS = TCU.Load;
+			TCU.GearChangeSLT = TCU.SLT;
+			TCU.GearChangeSLN = TCU.SLN;
 
-	TCU.Gear = 4;
-	TCU.GearChange = 0;	
+			gear_change_wait_start(0);
+			GearChangeStage = 2;
+			break;
+		case 2:
+			if (!gear_change_wait()) {break;}
+
+			TCU.Gear = 4;
+			gear_change_finish();
+			break;
+	}
 }
 
 static void gear_change_4_5() {
-	if (TCU.OilTemp < 30) {return;}
-	TCU.GearChange = 1;
+	switch (GearChangeStage) {
+		case 0:
+			if (TCU.OilTemp < 30) {
+				gear_change_finish();
+				break;
+			}
+			TCU.GearChange = 1;
 
-	set_sln(get_sln_pressure_gear5());
-	loop_wait(GearChangeStep * 3);
-	set_solenoids(5);		// Установка шифтовых соленоидов.
+			set_sln(get_sln_pressure_gear5());
+			WaitTimer = GearChangeStep * 3;
+			GearChangeStage = 1;
+			break;
+		case 1:
+			if (WaitTimer) {break;}
 
-	gear_change_wait(1, 0);
+			set_solenoids(5);		// Установка шифтовых соленоидов.
+			gear_change_wait_start(0);
+			GearChangeStage = 2;
+			break;
+		case 2:
+			if (!gear_change_wait()) {break;}
 
-	TCU.Gear = 5;
-	TCU.GearChange = 0;	
+			TCU.Gear = 5;
+			gear_change_finish();
+			break;
+	}
 }
 
 //=========================== Переключения вниз ===============================
 static void gear_change_5_4() {
-	TCU.GearChange = -1;
-
-	// Подгазовка.
-	//if (TCU.InstTPS <= CFG.IdleTPSLimit) {SET_PIN_HIGH(REQUEST_POWER_DOWN_PIN);}
-	
 	// Добавка к значению SLN из таблицы.
 	int8_t Add = 64;
 
-	if (TCU.Glock) {			// Отключаем блокировку ГТ.
-		set_slu(CFG.MinPressureSLU);
-		TCU.Glock = 64;			// Сброс счётчика блокировки
-	}
+	switch (GearChangeStage) {
+		case 0:
+			TCU.GearChange = -1;
 
-	set_sln(get_sln_pressure() + Add);
-	loop_wait(GearChangeStep * 3);
-	set_solenoids(4);		// Установка шифтовых соленоидов.
+			// Подгазовка.
+			//if (TCU.InstTPS <= CFG.IdleTPSLimit) {SET_PIN_HIGH(REQUEST_POWER_DOWN_PIN);}
 
-	gear_change_wait(-1, Add);
+			if (TCU.Glock) {			// Отключаем блокировку ГТ.
+				set_slu(CFG.MinPressureSLU);
+				TCU.Glock = 64;			// Сброс счётчика блокировки
+			}
 
-	TCU.Gear = 4;
-	TCU.GearChange = 0;		
+			set_sln(get_sln_pressure() + Add);
+			WaitTimer = GearChangeStep * 3;
+			GearChangeStage = 1;
+			break;
+		case 1:
+			if (WaitTimer) {break;}
+
+			set_solenoids(4);		// Установка шифтовых соленоидов.
+			gear_change_wait_start(Add);
+			GearChangeStage = 2;
+			break;
+		case 2:
+			if (!gear_change_wait()) {break;}
+
+			TCU.Gear = 4;
+			gear_change_finish();
+			break;
+	}
 }
 
 static void gear_change_4_3() {
-	TCU.GearChange = -1;
-
 	// Добавка к значению SLN из таблицы.
 	int8_t Add = 32;
 
-	if (TCU.Glock) {			// Отключаем блокировку ГТ.
-		set_slu(CFG.MinPressureSLU);
-		TCU.Glock = 64;			// Сброс счётчика блокировки
-	}
-	set_sln(get_sln_pressure() + Add);
-	loop_wait(GearChangeStep * 3);
-	
-	set_solenoids(3);			// Установка шифтовых соленоидов.
-	// Отличие для режима 3. 
-	if (TCU.ATMode == 6) {SET_PIN_HIGH(SOLENOID_S3_PIN);}
+	switch (GearChangeStage) {
+		case 0:
+			TCU.GearChange = -1;
 
-	gear_change_wait(-1, Add);
+			if (TCU.Glock) {			// Отключаем блокировку ГТ.
+				set_slu(CFG.MinPressureSLU);
+				TCU.Glock = 64;			// Сброс счётчика блокировки
+			}
+			set_sln(get_sln_pressure() + Add);
+			WaitTimer = GearChangeStep * 3;
+			GearChangeStage = 1;
+			break;
+		case 1:
+			if (WaitTimer) {break;}
 
-	TCU.Gear = 3;
-	TCU.GearChange = 0;	
-}
+			set_solenoids(3);			// Установка шифтовых соленоидов.
+			// Отличие для режима 3.
+			if (TCU.ATMode == 6) {SET_PIN_HIGH(SOLENOID_S3_PIN);}
 
-static void gear_change_3_2() {
-	TCU.GearChange = -1;
+			gear_change_wait_start(Add);
+			GearChangeStage = 2;
+			break;
+		case 2:
+			if (!gear_change_wait()) {break;}
 
-	if (TCU.ATMode == 6 || TCU.ATMode == 7) {
-		// Включение второй передачи в режимах "3" и "L2".
-		set_solenoids(2);					// Установка шифтовых соленоидов.
-		SET_PIN_HIGH(SOLENOID_S3_PIN);		// Включаем систему "Clutch to Clutch".
+			TCU.Gear = 3;
+			gear_change_finish();
+			break;
+	}
+}
 
-		uint16_t NextSLU = get_slu_pressure_gear2();
-		set_slu(NextSLU);
-		set_sln(CFG.MinPressureSLN);
+static void gear_change_3_2() {
+	switch (GearChangeStage) {
+		case 0:
+			TCU.GearChange = -1;
 
-		TCU.GearStep = 0;		// Шаг процесса включения передачи.
+			if (TCU.ATMode == 6 || TCU.ATMode == 7) {
+				// Включение второй передачи в режимах "3" и "L2".
+				set_solenoids(2);					// Установка шифтовых соленоидов.
+				SET_PIN_HIGH(SOLENOID_S3_PIN);		// Включаем систему "Clutch to Clutch".
 
-		while (TCU.GearStep < GEAR_2_MAX_STEP) {
-			set_gear_change_delays();		// Длительность 1 шага переключения от ДПДЗ.
-			WaitTimer = GearChangeStep;		// Устанавливаем время ожидания.
-			while (WaitTimer) {
-				loop_main(1);
+				set_slu(get_slu_pressure_gear2());
+				set_sln(CFG.MinPressureSLN);
 
-				NextSLU = get_slu_pressure_gear2() + TCU.GearStep * 2;
-				set_slu(NextSLU);
+				TCU.GearStep = 0;		// Шаг процесса включения передачи.
+				set_gear_change_delays();		// Длительность 1 шага переключения от ДПДЗ.
+				WaitTimer = GearChangeStep;		// Устанавливаем время ожидания.
+				GearChangeStage = 1;
+			}
+			else {
+				// Без торможения двигателем вторая передача будет включаться
+				// в функции slu_gear2_control.
+				set_solenoids(1);					// Установка шифтовых соленоидов.
+				set_slu(CFG.MinPressureSLU);
+				WaitTimer = 100;
+				GearChangeStage = 2;
 			}
+			break;
+		case 1:
+			slu_gear2_step(0);
+			if (WaitTimer) {break;}
+
 			TCU.GearStep++;
-		}
-		SET_PIN_LOW(SOLENOID_S3_PIN);
-		set_sln(CFG.IdlePressureSLN);
-		TCU.Gear2State = 8;
+			if (TCU.GearStep < GEAR_2_MAX_STEP) {
+				set_gear_change_delays();
+				WaitTimer = GearChangeStep;
+				break;
+			}
+
+			SET_PIN_LOW(SOLENOID_S3_PIN);
+			set_sln(CFG.IdlePressureSLN);
+			TCU.Gear2State = 8;
+			TCU.Gear = 2;
+			gear_change_finish();
+			break;
+		case 2:
+			if (WaitTimer) {break;}
+
+			TCU.Gear2State = 0;
+			TCU.Gear = 2;
+			gear_change_finish();
+			break;
 	}
-	else {
-		// Без торможения двигателем вторая передача будет включаться
-		// в функции slu_gear2_control.
-		set_solenoids(1);					// Установка шифтовых соленоидов.
-		set_slu(CFG.MinPressureSLU);
-		loop_wait(100);
-		TCU.Gear2State = 0;
+}
+
+static void gear_change_2_1() {
+	switch (GearChangeStage) {
+		case 0:
+			TCU.GearChange = -1;
+
+			set_solenoids(1);		// Установка шифтовых соленоидов.
+			// Отличие для режима L2.
+			if (TCU.ATMode == 7) {SET_PIN_HIGH(SOLENOID_S3_PIN);}
+
+			set_slu(CFG.MinPressureSLU);
+			set_sln(get_sln_pressure());
+			WaitTimer = GearChangeStep * 8;
+			GearChangeStage = 1;
+			break;
+		case 1:
+			if (WaitTimer) {break;}
+
+			set_sln(CFG.IdlePressureSLN);
+
+			TCU.Gear = 1;
+			TCU.Gear2State = 0;
+			gear_change_finish();
+			break;
 	}
+}
 
-	TCU.Gear = 2;
-	TCU.GearChange = 0;	
-}	
+//===================== Включение второй передачи (SLU) =======================
+// Плавное включение второй передачи после её временного отключения.
+static void gear2_engage() {
+	int16_t DeltaRPM = 0;
 
-static void gear_change_2_1() {
-	TCU.GearChange = -1;
+	switch (GearChangeStage) {
+		case 0:
+			set_slu(get_slu_pressure_gear2());
+			WaitTimer = 200;
+			GearChangeStage = 1;
+			break;
+		case 1:
+			if (WaitTimer) {break;}
 
-	set_solenoids(1);		// Установка шифтовых соленоидов.
-	// Отличие для режима L2. 
-	if (TCU.ATMode == 7) {SET_PIN_HIGH(SOLENOID_S3_PIN);}
+			set_solenoids(2);					// Установка шифтовых соленоидов.
+			SET_PIN_HIGH(SOLENOID_S3_PIN);		// Включаем систему "Clutch to Clutch".
+			TCU.Gear2State = 1;
 
-	set_slu(CFG.MinPressureSLU);
-	set_sln(get_sln_pressure());
-	loop_wait(GearChangeStep * 8);
-	set_sln(CFG.IdlePressureSLN);
+			TCU.GearStep = 0;
+			ShiftMaxDeltaRPM = 0;
+			gear2_engage_step_timer();
+			GearChangeStage = 2;
+			break;
+		case 2:
+			DeltaRPM = rpm_delta(2);
+			TCU.GearDownSpeed = get_gear_min_speed(TCU.Gear);
 
-	TCU.Gear = 1;
-	TCU.Gear2State = 0;
-	TCU.GearChange = 0;
+			// Отключение передачи при сбросе газа.
+			if (TCU.InstTPS <= CFG.IdleTPSLimit && TCU.ATMode != 6 && TCU.ATMode != 7) {
+				set_solenoids(1);
+				set_slu(CFG.MinPressureSLU);
+				TCU.Gear2State = 0;
+				WaitTimer = 200;
+				GearChangeStage = 3;
+				break;
+			}
+
+			// Скорость ниже порога.
+			if (TCU.CarSpeedFine < (uint16_t) TCU.GearDownSpeed * 100) {
+				TCU.Gear2State = 0;
+				gear_change_start(gear_change_2_1);
+				break;
+			}
+
+			// Фиксация максимальной разница оборотов (проскальзывание).
+			if (DeltaRPM > ShiftMaxDeltaRPM) {ShiftMaxDeltaRPM = DeltaRPM;}
+
+			slu_gear2_step(0);
+			if (WaitTimer) {break;}
+
+			TCU.GearStep++;
+			if (TCU.GearStep < GEAR_2_MAX_STEP) {
+				gear2_engage_step_timer();
+				break;
+			}
+
+			SET_PIN_LOW(SOLENOID_S3_PIN);
+			set_sln(CFG.IdlePressureSLN);
+			TCU.Gear2State = 8;
+
+			// Применение адаптации.
+			if (TCU.ATMode != 6 && TCU.ATMode != 7 && InitDrumRPMDelta) {
+				// Обороты проскачили нулевую точку, передача включилась поздно.
+				if (ShiftMaxDeltaRPM > 60) {save_gear2_adv_adaptation(1, InitDrumRPMDelta);}
+				// Обороты сликом близко к нулевойю точку, передача включилась рано.
+				else if (ShiftMaxDeltaRPM < 40) {save_gear2_adv_adaptation(-1, InitDrumRPMDelta);}
+			}
+			gear_change_finish();
+			break;
+		case 3:
+			// Пауза после отключения передачи при сбросе газа.
+			if (WaitTimer) {break;}
+			gear_change_finish();
+			break;
+	}
+}
+
+// Длительность шага включения второй передачи.
+static void gear2_engage_step_timer() {
+	set_gear_change_delays();		// Длительность 1 шага переключения от ДПДЗ.
+	// Устанавливаем время ожидания.
+	if (TCU.ATMode == 6 || TCU.ATMode == 7) {WaitTimer = GearChangeStep;}
+	else {WaitTimer = CFG.G2ReactStepSize;}	// Статическое значение при реактивации.
+}
+
+// Давление SLU на текущем шаге включения второй передачи,
+// Delay - снижение давления от значения шага.
+// Значение пересчитывается на каждом проходе (таблица и температура),
+// в регистр записывается только при изменении.
+static void slu_gear2_step(uint8_t Delay) {
+	uint16_t Value = get_slu_pressure_gear2() + TCU.GearStep * 2 - Delay;
+	if (Value != pressure_get(PRESSURE_SLU) || pressure_ramp_active(PRESSURE_SLU)) {set_slu(Value);}
+}
+
+// Пауза без управления, выдерживается установленное время WaitTimer.
+static void gear_change_pause() {
+	if (!WaitTimer) {gear_change_finish();}
 }
 
 //========================== Вспомогательные функции ==========================
 
 // Контроль переключения передач.
 void gear_control() {
+	if (GearChangeProcess) {return;}	// Предыдущее переключение еще не завершено.
+
 	if (TCU.ManualModeTimer && CFG.TiptronicTimer) {TCU.ManualModeTimer--;}
 
 	// Только режимы D - L.
@@ -494,26 +747,27 @@ void gear_control() {
 	}
 
 	// Скорость выше порога.
-	if (TCU.CarSpeed > TCU.GearUpSpeed) {
+	if (TCU.CarSpeedFine > (uint16_t) TCU.GearUpSpeed * 100) {
 		if (TCU.InstTPS > CFG.IdleTPSLimit) {	// Не повышать передачу при сбросе газа.
 			if (rpm_after_ok(1)) {gear_up();}
 		}
 		return;
 	}
 	// Скорость ниже порога.
-	if (TCU.CarSpeed < TCU.GearDownSpeed) {
+	if (TCU.CarSpeedFine < (uint16_t) TCU.GearDownSpeed * 100) {
 		if (rpm_after_ok(-1)) {gear_down();}
 		return;
 	}
 }
 
 void slu_gear2_control() {
-	// Дельта оборотов, при котором началось переключение.
-	static int16_t InitDrumRPMDelta = 0;
 	// 0 - ХХ,
 	// 1 - плавное включение,
 	// 8 - рабочий режим.
 
+	// Плавное включение выполняется в процессе переключения.
+	if (GearChangeProcess) {return;}
+
 	if (TCU.Gear == 1) {set_slu(get_slu_pressure_gear2());}
 
 	if (TCU.Gear != 2) {
@@ -527,13 +781,15 @@ void slu_gear2_control() {
 		if (TCU.Gear2State > 0) {
 			set_solenoids(1);
 			set_slu(CFG.MinPressureSLU);
-			loop_wait(200);
+			TCU.Gear2State = 0;
+			WaitTimer = 200;
+			gear_change_start(gear_change_pause);
+			return;
 		}
 		TCU.Gear2State = 0;
 	}
 
 	int16_t DeltaRPM = rpm_delta(2);
-	int16_t MaxDeltaRPM = 0;
 	uint16_t NextSLU = get_slu_pressure_gear2();		// Начальное давление.
 	uint16_t WorkSLU = NextSLU + ((NextSLU * 32) >> 7);	// Рабочее давление (+25%).
 
@@ -547,72 +803,16 @@ void slu_gear2_control() {
 			InitDrumRPMDelta = 0;
 
 			if (TCU.ATMode == 6 || TCU.ATMode == 7) {	// Переключили режим АКПП.
-				set_slu(NextSLU);
-				loop_wait(200);
-				set_solenoids(2);
-				SET_PIN_HIGH(SOLENOID_S3_PIN);		// Включаем систему "Clutch to Clutch".
-				TCU.Gear2State = 1;
+				gear_change_start(gear2_engage);
 			}
 			else if (TCU.InstTPS > CFG.IdleTPSLimit && (-1 * DeltaRPM) < get_gear2_rpm_adv()) {
 				InitDrumRPMDelta = TCU.DrumRPMDelta;
-				set_slu(NextSLU);
-				loop_wait(200);
-				set_solenoids(2);
-				SET_PIN_HIGH(SOLENOID_S3_PIN);		// Включаем систему "Clutch to Clutch".
-				TCU.Gear2State = 1;
+				gear_change_start(gear2_engage);
 			}
 			break;
 		case 1:
-			// Плавное включение второй передачи.
-			set_solenoids(2);					// Установка шифтовых соленоидов.
-			SET_PIN_HIGH(SOLENOID_S3_PIN);		// Включаем систему "Clutch to Clutch".
-			TCU.GearStep = 0;
-			while (TCU.GearStep < GEAR_2_MAX_STEP) {
-				set_gear_change_delays();		// Длительность 1 шага переключения от ДПДЗ.
-				// Устанавливаем время ожидания.
-				if (TCU.ATMode == 6 || TCU.ATMode == 7) {WaitTimer = GearChangeStep;}
-				else {WaitTimer = CFG.G2ReactStepSize;}	// Статическое значение при реактивации.
-
-				while (WaitTimer) {
-					loop_main(1);
-					DeltaRPM = rpm_delta(2);
-					TCU.GearDownSpeed = get_gear_min_speed(TCU.Gear);
-
-					// Отключение передачи при сбросе газа.
-					if (TCU.InstTPS <= CFG.IdleTPSLimit && TCU.ATMode != 6 && TCU.ATMode != 7) {
-						set_solenoids(1);
-						set_slu(CFG.MinPressureSLU);
-						loop_wait(200);
-						TCU.Gear2State = 0;
-						return;
-					}
-
-					// Скорость ниже порога.
-					if (TCU.CarSpeed < TCU.GearDownSpeed) {
-						TCU.Gear2State = 0;
-						gear_change_2_1();
-						return;
-					}
-
-					// Фиксация максимальной разница оборотов (проскальзывание).
-					if (DeltaRPM > MaxDeltaRPM) {MaxDeltaRPM = DeltaRPM;}
-
-					NextSLU = get_slu_pressure_gear2() + TCU.GearStep * 2;
-					set_slu(NextSLU);
-				}
-				TCU.GearStep++;
-			}
-			SET_PIN_LOW(SOLENOID_S3_PIN);
-			set_sln(CFG.IdlePressureSLN);
-			TCU.Gear2State = 8;
-
-			// Применение адаптации.
-			if (TCU.ATMode != 6 && TCU.ATMode != 7 && InitDrumRPMDelta) {
-				// Обороты проскачили нулевую точку, передача включилась поздно.
-				if (MaxDeltaRPM > 60) {save_gear2_adv_adaptation(1, InitDrumRPMDelta);}
-				// Обороты сликом близко к нулевойю точку, передача включилась рано.
-				else if (MaxDeltaRPM < 40) {save_gear2_adv_adaptation(-1, InitDrumRPMDelta);}
-			}
+			// Включение было прервано, начинаем заново.
+			TCU.Gear2State = 0;
 			break;
 		case 8:
 			set_slu(WorkSLU);
@@ -620,6 +820,60 @@ void slu_gear2_control() {
 	}
 }
 
+// Шаг текущего процесса переключения, вызов каждую 1 мс.
+void gear_change_step() {
+	if (!GearChangeProcess) {return;}
+
+	// Двигатель заглушен, ручное управление соленоидами
+	// или селектором выбран режим без движения вперед.
+	if (!TCU.EngineWork || TCU.DebugMode == 2 || TCU.ATMode < 4 || TCU.ATMode > 8) {
+		gear_change_cancel();
+		return;
+	}
+	GearChangeProcess();
+}
+
+// Возвращает 1, если идет процесс переключения.
+uint8_t gear_change_active() {
+	if (GearChangeProcess) {return 1;}
+	else {return 0;}
+}
+
+// Запуск процесса переключения, первый этап выполняется сразу.
+static void gear_change_start(void (*Process)()) {
+	GearChangeProcess = Process;
+	GearChangeStage = 0;
+	GearChangeStartTime = get_time_ms();
+	ratio_shift_reset();		// Фазы нового переключения.
+	GearChangeProcess();
+}
+
+// Завершение процесса переключения.
+static void gear_change_finish() {
+	// Запись времени переключения для анализа.
+	if (TCU.GearChange) {
+		TCU.GearChangeStart = GearChangeStartTime;
+		TCU.GearChangeTime = get_time_ms() - GearChangeStartTime;
+	}
+
+	// Отмена запланированных действий прерванного переключения.
+	actuator_cancel(ShiftSLUEvent);
+	actuator_cancel(ShiftSLNEvent);
+	ShiftSLUEvent = ACT_NONE;
+	ShiftSLNEvent = ACT_NONE;
+
+	GearChangeProcess = 0;
+	GearChangeStage = 0;
+	TCU.GearChange = 0;
+}
+
+// Прерывание процесса переключения,
+// соленоиды уже установлены вызвавшей прерывание функцией.
+static void gear_change_cancel() {
+	SET_PIN_LOW(REQUEST_POWER_DOWN_PIN);
+	gear_change_finish();
+}
+
 // Настройка выходов шифтовых селеноидов, а также лампы заднего хода.
 void solenoid_init() {
 	SET_PIN_MODE_OUTPUT(SOLENOID_S1_PIN);
@@ -639,42 +893,58 @@ void solenoid_init() {
 	SET_PIN_LOW(REQUEST_POWER_DOWN_PIN);	
 }
 
-static void gear_change_wait(int8_t GearChange, int8_t Add) {
-	uint8_t PDR = 0;
-	uint16_t PDRTime = 0;	// Для фиксации времени работы PDR.
-	if (TCU.Load > CFG.PowerDownMaxTPS) {PDR = -1;}
+// Начало ожидания завершения переключения 3>4, 4>5, 5>4, 4>3.
+// Направление переключения берется из TCU.GearChange.
+static void gear_change_wait_start(int8_t Add) {
+	ShiftAdd = Add;
+	ShiftPDR = 0;
+	ShiftPDRTime = 0;
+	if (TCU.Load > CFG.PowerDownMaxTPS) {ShiftPDR = -1;}
 	TCU.LastPDRTime = 0;
 	WaitTimer = GEAR_CHANGE_MAX_TIME;		// Устанавливаем время ожидания.
 
-	// Отличие оборотов от текущей передачи.
-	int16_t DeltaCurr = rpm_delta(TCU.Gear) * GearChange;	
 	// Отличие оборотов от следующей передачи.
-	int16_t DeltaNext = rpm_delta(TCU.Gear + GearChange) * GearChange;
+	ShiftDeltaNext = rpm_delta(TCU.Gear + TCU.GearChange) * TCU.GearChange;
+	ShiftWaitStage = 0;
+}
 
-	while (WaitTimer && DeltaNext > 35) {
-		DeltaCurr = rpm_delta(TCU.Gear) * GearChange;	
-		DeltaNext = rpm_delta(TCU.Gear + GearChange) * GearChange;
+// Ожидание завершения переключения, возвращает 1 по окончании.
+static uint8_t gear_change_wait() {
+	int8_t GearChange = TCU.GearChange;
 
-		if (TCU.Gear == 4 && GearChange == 1) {set_sln(get_sln_pressure_gear5());}
-		else {set_sln(get_sln_pressure() + Add);}
-		if (DeltaCurr < -70) {						// Переключение началось.
-			if (TCU.Glock && GearChange == 1) {		// Отключаем блокировку ГТ.
-				set_slu(CFG.MinPressureSLU);
-				TCU.Glock = 64;				// Сброс счётчика блокировки
-			}
-			if (!PDR) {						// Запрашиваем снижение мощности.
-				PDR = 1;
-				PDRTime = WaitTimer;
-				SET_PIN_HIGH(REQUEST_POWER_DOWN_PIN);
+	switch (ShiftWaitStage) {
+		case 0:
+			if (WaitTimer && ShiftDeltaNext > 35) {
+				ShiftDeltaNext = rpm_delta(TCU.Gear + GearChange) * GearChange;
+
+				if (TCU.Gear == 4 && GearChange == 1) {set_sln(get_sln_pressure_gear5());}
+				else {set_sln(get_sln_pressure() + ShiftAdd);}
+				if (ratio_phase_reached(PHASE_INERTIA)) {	// Переключение началось.
+					if (TCU.Glock && GearChange == 1) {		// Отключаем блокировку ГТ.
+						set_slu(CFG.MinPressureSLU);
+						TCU.Glock = 64;				// Сброс счётчика блокировки
+					}
+					if (!ShiftPDR) {				// Запрашиваем снижение мощности.
+						ShiftPDR = 1;
+						ShiftPDRTime = WaitTimer;
+						SET_PIN_HIGH(REQUEST_POWER_DOWN_PIN);
+					}
+				}
+				return 0;
 			}
-		}
-		loop_main(1);
-	}
 
-	SET_PIN_LOW(REQUEST_POWER_DOWN_PIN);
-	if (PDR == 1) {TCU.LastPDRTime = PDRTime - WaitTimer;}
-	loop_wait(GearChangeStep * 3);
-	set_sln(CFG.IdlePressureSLN);
+			SET_PIN_LOW(REQUEST_POWER_DOWN_PIN);
+			if (ShiftPDR == 1) {TCU.LastPDRTime = ShiftPDRTime - WaitTimer;}
+			WaitTimer = GearChangeStep * 3;
+			ShiftWaitStage = 1;
+			return 0;
+		case 1:
+			if (WaitTimer) {return 0;}
+			set_sln(CFG.IdlePressureSLN);
+			ShiftWaitStage = 0;
+			return 1;
+	}
+	return 0;
 }
 
 // Обновление порогов переключения передач.
@@ -689,16 +959,16 @@ static void gear_up() {
 
 	switch (TCU.Gear) {
 		case 1:
-			gear_change_1_2();
+			gear_change_start(gear_change_1_2);
 			break;
 		case 2:
-			gear_change_2_3();
+			gear_change_start(gear_change_2_3);
 			break;
 		case 3:
-			gear_change_3_4();
+			gear_change_start(gear_change_3_4);
 			break;
 		case 4:
-			gear_change_4_5();
+			gear_change_start(gear_change_4_5);
 			break;
 	}
 }
@@ -709,16 +979,16 @@ static void gear_down() {
 
 	switch (TCU.Gear) {
 		case 2:
-			gear_change_2_1();
+			gear_change_start(gear_change_2_1);
 			break;
 		case 3:
-			gear_change_3_2();
+			gear_change_start(gear_change_3_2);
 			break;
 		case 4:
-			gear_change_4_3();
+			gear_change_start(gear_change_4_3);
 			break;
 		case 5:
-			gear_change_5_4();
+			gear_change_start(gear_change_5_4);
 			break;
 	}	
 }
@@ -727,12 +997,6 @@ static void set_gear_change_delays() {
 	GearChangeStep = get_interpolated_value_uint16_t(TCU.Load, GRIDS.TPSGrid, TABLES.GearChangeStepArray, TPS_GRID_SIZE);
 }
 
-// Ожидание с основным циклом.
-static void loop_wait(uint16_t Delay) {
-	WaitTimer = Delay;		// Устанавливаем время ожидания.
-	while (WaitTimer) {loop_main(1);}
-}
-
 uint8_t get_gear_max_speed(int8_t Gear) {
 	if (Gear == 5 || Gear <= 0) {return 130;}
 
@@ -812,17 +1076,11 @@ static uint8_t rpm_after_ok(uint8_t Shift) {
 }
 
 static void set_sln(uint16_t Value) {
-	TCU.SLN = Value;
-	cli();
-		OCR1B = TCU.SLN;	// SLN - выход B таймера 1.
-	sei();
+	pressure_set(PRESSURE_SLN, Value);
 }
 
 static void set_slu(uint16_t Value) {
-	TCU.SLU = Value;
-	cli();
-		OCR1C = TCU.SLU;	// SLU - выход C таймера 1.
-	sei();
+	pressure_set(PRESSURE_SLU, Value);
 }
 
 int8_t get_min_gear(uint8_t Mode) {
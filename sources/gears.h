@@ -15,6 +15,8 @@
 	void update_gear_speed();
 	void gear_control();
 	void slu_gear2_control();
+	void gear_change_step();
+	uint8_t gear_change_active();
 
 	int8_t get_min_gear(uint8_t Mode);
 	int8_t get_max_gear(uint8_t Mode);
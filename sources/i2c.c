@@ -3,6 +3,7 @@
 #include <avr/interrupt.h>	// Прерывания.
 
 #include "i2c.h"			// Свой заголовок.
+#include "critical.h"		// Критические секции.
 
 /***********!!! НЕЛЬЗЯ ТРОГАТЬ БУФЕР ПОКА ОН НЕ ОТПРАВЛЕН !!!************/
 
@@ -86,17 +87,19 @@ void i2c_send_data(uint8_t *Array, uint16_t TxSize) {
 
 // Возвращает готовность интерфейса к новому заданию.
 uint8_t i2c_ready() {
-	cli();
-		uint8_t RD = Ready;
-	sei();
+	uint8_t RD = 0;
+	CRITICAL_BEGIN();
+		RD = Ready;
+	CRITICAL_END();
 	return RD;
 }
 
 // Возвращает статус интерфейса.
 uint8_t i2c_get_status() {
-	cli();
-		uint8_t CurrentStatus = Status;	// Текущий статус TWI.
-	sei();
+	uint8_t CurrentStatus = 0;
+	CRITICAL_BEGIN();
+		CurrentStatus = Status;	// Текущий статус TWI.
+	CRITICAL_END();
 	return CurrentStatus;
 }
 
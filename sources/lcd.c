@@ -20,9 +20,6 @@ static void lcd_port_update();
 static void lcd_send_byte(uint8_t Data, uint8_t Com);
 static void lcd_set_cursor(uint8_t Row, uint8_t Col);
 
-// Прототипы функций.
-void loop_main(uint8_t Wait);		// Прототип функций из main.c.
-
 // Настройка дисплея, необходимо передать адрес и тип.
 void lcd_init(uint8_t Addr) {
 	SendArray[0] = Addr;
@@ -39,6 +39,8 @@
 	#define DEBUG_SCREEN_BUTTON_R_PIN K, 5
 
 	// ============== DEBUG ==============
+	// Второй выход скорости, OC3C таймера 3.
+	#define SPEED2_OUT_PIN E, 5
 #endif
 
 
@@ -0,0 +1,157 @@
+#include <stdint.h>			// Коротние название int.
+#include <avr/io.h>			// Названия регистров и номера бит.
+#include <avr/interrupt.h>	// Прерывания.
+
+#include "pressure.h"		// Свой заголовок.
+#include "tcudata.h"		// Расчет и хранение всех необходимых параметров.
+#include "critical.h"		// Критические секции.
+
+#define PRESSURE_CHANNELS 3
+// Полный путь изменения, 1.0 в формате 16.16.
+#define RAMP_FULL 65536UL
+
+// Структура канала.
+typedef struct RAMP_t {
+	uint16_t Value;		// Текущее значение ШИМ.
+	uint16_t Start;		// Начальное значение.
+	uint16_t Target;	// Конечное значение.
+	uint32_t Pos;		// Пройденная часть пути (RAMP_FULL - весь путь).
+	uint32_t Step;		// Шаг за один период ШИМ.
+	uint8_t Shape;		// Форма кривой.
+	uint8_t Active;		// Идет изменение.
+} RAMP_t;
+
+static volatile RAMP_t Ramp[PRESSURE_CHANNELS] = {};
+
+// Прототипы локальных функций.
+static void pressure_write(uint8_t N, uint16_t Value);
+static uint16_t ramp_shape(uint8_t Shape, uint16_t T);
+
+// Установка значения сразу, текущее изменение отменяется.
+void pressure_set(uint8_t N, uint16_t Value) {
+	CRITICAL_BEGIN();
+		Ramp[N].Active = 0;
+		Ramp[N].Value = Value;
+		pressure_write(N, Value);
+	CRITICAL_END();
+
+	switch (N) {
+		case PRESSURE_SLT:
+			TCU.SLT = Value;
+			break;
+		case PRESSURE_SLN:
+			TCU.SLN = Value;
+			break;
+		case PRESSURE_SLU:
+			TCU.SLU = Value;
+			break;
+	}
+}
+
+// Установка значения из прерывания или при запрещенных прерываниях.
+// TCU обновится при следующем вызове pressure_sync.
+void pressure_apply(uint8_t N, uint16_t Value) {
+	Ramp[N].Active = 0;
+	Ramp[N].Value = Value;
+	pressure_write(N, Value);
+}
+
+// Плавное изменение до Target за время Time (мс).
+void pressure_ramp(uint8_t N, uint16_t Target, uint16_t Time, uint8_t Shape) {
+	// Время меньше периода ШИМ, устанавливаем сразу.
+	if ((uint32_t) Time * 1000 < PRESSURE_PERIOD_US) {
+		pressure_set(N, Target);
+		return;
+	}
+
+	uint32_t Step = (RAMP_FULL * PRESSURE_PERIOD_US) / ((uint32_t) Time * 1000);
+
+	CRITICAL_BEGIN();
+		Ramp[N].Start = Ramp[N].Value;
+		Ramp[N].Target = Target;
+		Ramp[N].Pos = 0;
+		Ramp[N].Step = Step;
+		Ramp[N].Shape = Shape;
+		Ramp[N].Active = 1;
+	CRITICAL_END();
+}
+
+// Линейное изменение до Target со скоростью Slope (единиц ШИМ в секунду).
+void pressure_slope(uint8_t N, uint16_t Target, uint16_t Slope) {
+	uint16_t Value = pressure_get(N);
+	uint16_t Delta = Target > Value ? Target - Value : Value - Target;
+
+	if (!Slope || !Delta) {
+		pressure_set(N, Target);
+		return;
+	}
+	pressure_ramp(N, Target, ((uint32_t) Delta * 1000) / Slope, RAMP_LINEAR);
+}
+
+// Текущее значение ШИМ канала.
+uint16_t pressure_get(uint8_t N) {
+	uint16_t Value = 0;
+	CRITICAL_BEGIN();
+		Value = Ramp[N].Value;
+	CRITICAL_END();
+	return Value;
+}
+
+// Возвращает 1, если идет изменение давления.
+uint8_t pressure_ramp_active(uint8_t N) {
+	return Ramp[N].Active;
+}
+
+// Копирование текущих значений в структуру TCU.
+void pressure_sync() {
+	TCU.SLT = pressure_get(PRESSURE_SLT);
+	TCU.SLN = pressure_get(PRESSURE_SLN);
+	TCU.SLU = pressure_get(PRESSURE_SLU);
+}
+
+static void pressure_write(uint8_t N, uint16_t Value) {
+	switch (N) {
+		case PRESSURE_SLT:
+			OCR1A = Value;	// SLT - выход A таймера 1.
+			break;
+		case PRESSURE_SLN:
+			OCR1B = Value;	// SLN - выход B таймера 1.
+			break;
+		case PRESSURE_SLU:
+			OCR1C = Value;	// SLU - выход C таймера 1.
+			break;
+	}
+}
+
+// Значение кривой (0..256) от доли пути T (0..256).
+static uint16_t ramp_shape(uint8_t Shape, uint16_t T) {
+	switch (Shape) {
+		case RAMP_SMOOTH:
+			// 3t^2 - 2t^3.
+			return (((uint32_t) T * T >> 8) * (768 - 2 * T)) >> 8;
+		case RAMP_FAST:
+			// 1 - (1 - t)^2.
+			return 256 - (((uint32_t) (256 - T) * (256 - T)) >> 8);
+		default:
+			return T;
+	}
+}
+
+// Прерывание по переполнению таймера 1, один раз за период ШИМ.
+ISR (TIMER1_OVF_vect) {
+	for (uint8_t i = 0; i < PRESSURE_CHANNELS; i++) {
+		if (!Ramp[i].Active) {continue;}
+
+		Ramp[i].Pos += Ramp[i].Step;
+		if (Ramp[i].Pos >= RAMP_FULL) {
+			Ramp[i].Value = Ramp[i].Target;
+			Ramp[i].Active = 0;
+		}
+		else {
+			int32_t Delta = (int32_t) Ramp[i].Target - Ramp[i].Start;
+			uint16_t K = ramp_shape(Ramp[i].Shape, Ramp[i].Pos >> 8);
+			Ramp[i].Value = Ramp[i].Start + ((Delta * K) >> 8);
+		}
+		pressure_write(i, Ramp[i].Value);
+	}
+}
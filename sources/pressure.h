@@ -0,0 +1,40 @@
+// Управление ШИМ соленоидов давления SLT, SLN, SLU с плавным изменением.
+
+#ifndef _PRESSURE_H_
+	#define _PRESSURE_H_
+
+	// Каналы (выходы таймера 1).
+	#define PRESSURE_SLT	0	// OCR1A.
+	#define PRESSURE_SLN	1	// OCR1B.
+	#define PRESSURE_SLU	2	// OCR1C.
+
+	// Форма кривой изменения давления.
+	#define RAMP_LINEAR		0	// Линейная.
+	#define RAMP_SMOOTH		1	// S-образная, плавное начало и окончание.
+	#define RAMP_FAST		2	// Быстрое начало, плавное окончание.
+
+	// Период ШИМ таймера 1 (1024 * 64 / 16 МГц), мкс.
+	#define PRESSURE_PERIOD_US	4096
+
+	void pressure_set(uint8_t N, uint16_t Value);
+	void pressure_apply(uint8_t N, uint16_t Value);
+	void pressure_ramp(uint8_t N, uint16_t Target, uint16_t Time, uint8_t Shape);
+	void pressure_slope(uint8_t N, uint16_t Target, uint16_t Slope);
+	uint16_t pressure_get(uint8_t N);
+	uint8_t pressure_ramp_active(uint8_t N);
+	void pressure_sync();
+
+#endif
+
+/*
+	Изменение давления выполняется в прерывании по переполнению таймера 1,
+	т.е. один раз за период ШИМ, независимо от времени основного цикла.
+	Регистры OCR1x в режиме Fast PWM буферизируются,
+	новое значение применяется со следующего периода.
+
+	pressure_set - установка значения сразу, текущее изменение отменяется.
+	pressure_apply - то же без запрета прерываний, для вызова из прерываний.
+	pressure_ramp - изменение до Target за Time мс по кривой Shape.
+	pressure_slope - линейное изменение до Target со скоростью Slope единиц ШИМ в секунду.
+	pressure_sync - копирование текущих значений в TCU.SLT/SLN/SLU.
+*/
@@ -0,0 +1,106 @@
+#include <stdint.h>			// Коротние название int.
+#include <avr/io.h>			// Названия регистров и номера бит.
+#include <avr/interrupt.h>	// Прерывания.
+
+#include "profiler.h"		// Свой заголовок.
+#include "timers.h"			// Таймеры.
+
+extern volatile uint16_t CycleTimer;	// Счетчик времени 10.5 мкс из main.
+
+// Период переполнения счетчика CycleTimer в шагах таймера.
+#define CYCLE_TIMER_WRAP (65536UL * CYCLE_TIMER_STEPS)
+
+static PROFILE_t Profile[PROF_COUNT];
+
+// Прототипы локальных функций.
+static uint32_t profiler_time();
+static uint8_t profiler_hist_bin(uint16_t Time);
+
+// Начало замера, возвращает метку времени.
+uint32_t profiler_start() {
+	return profiler_time();
+}
+
+// Окончание замера, время записывается в статистику функции N.
+void profiler_stop(uint8_t N, uint32_t Start) {
+	uint32_t End = profiler_time();
+	if (End < Start) {End += CYCLE_TIMER_WRAP;}	// Переполнение счетчика.
+
+	// Переводим шаги 0.5 мкс в мкс.
+	uint32_t Time32 = (End - Start) >> 1;
+	uint16_t Time = Time32 > UINT16_MAX ? UINT16_MAX : Time32;
+
+	PROFILE_t* P = &Profile[N];
+
+	if (!P->Count || Time < P->Min) {P->Min = Time;}
+	if (Time > P->Max) {P->Max = Time;}
+
+	// При переполнении счетчика делим сумму пополам, среднее сохраняется.
+	if (P->Count == UINT16_MAX) {
+		P->Count >>= 1;
+		P->Sum >>= 1;
+	}
+	P->Count++;
+	P->Sum += Time;
+
+	// При переполнении интервала гистограммы делим все интервалы пополам.
+	uint8_t Bin = profiler_hist_bin(Time);
+	if (P->Hist[Bin] == UINT8_MAX) {
+		for (uint8_t i = 0; i < PROF_HIST_SIZE; i++) {P->Hist[i] >>= 1;}
+	}
+	P->Hist[Bin]++;
+}
+
+// Сброс статистики.
+void profiler_clear() {
+	for (uint8_t i = 0; i < PROF_COUNT; i++) {
+		Profile[i].Min = 0;
+		Profile[i].Max = 0;
+		Profile[i].Sum = 0;
+		Profile[i].Count = 0;
+		for (uint8_t j = 0; j < PROF_HIST_SIZE; j++) {Profile[i].Hist[j] = 0;}
+	}
+}
+
+uint16_t profiler_get_min(uint8_t N) {
+	return Profile[N].Min;
+}
+
+uint16_t profiler_get_avg(uint8_t N) {
+	if (!Profile[N].Count) {return 0;}
+	return Profile[N].Sum / Profile[N].Count;
+}
+
+uint16_t profiler_get_max(uint8_t N) {
+	return Profile[N].Max;
+}
+
+uint8_t profiler_get_hist(uint8_t N, uint8_t Bin) {
+	return Profile[N].Hist[Bin];
+}
+
+// Текущее время в шагах таймера 2 (0.5 мкс).
+static uint32_t profiler_time() {
+	uint16_t Ticks = 0;
+	uint8_t Steps = 0;
+	// Состояние прерываний восстанавливается, замер возможен при запрещенных прерываниях.
+	uint8_t SaveSREG = SREG;
+	cli();
+		Ticks = CycleTimer;
+		Steps = TCNT2;
+		// Таймер уже сбросился, а прерывание еще не обработано.
+		if ((TIFR2 & (1 << OCF2A)) && Steps < CYCLE_TIMER_STEPS / 2) {Ticks++;}
+	SREG = SaveSREG;
+	return (uint32_t) Ticks * CYCLE_TIMER_STEPS + Steps;
+}
+
+// Номер интервала гистограммы по времени в мкс.
+static uint8_t profiler_hist_bin(uint16_t Time) {
+	uint8_t Bin = 0;
+	Time >>= 4;		// Меньше 16 мкс - нулевой интервал.
+	while (Time && Bin < PROF_HIST_SIZE - 1) {
+		Time >>= 1;
+		Bin++;
+	}
+	return Bin;
+}
@@ -0,0 +1,58 @@
+// Замер времени выполнения функций.
+
+#ifndef _PROFILER_H_
+	#define _PROFILER_H_
+
+	// Номера замеряемых функций.
+	#define PROF_ADC_READ				0
+	#define PROF_CALCULATE_TCU_DATA		1
+	#define PROF_CALC_TPS				2
+	#define PROF_SLT_CONTROL			3
+	#define PROF_GLOCK_CONTROL			4
+	#define PROF_GEAR_CONTROL			5
+	#define PROF_SLU_GEAR2_CONTROL		6
+	#define PROF_BMP_PROCCESS			7
+	#define PROF_LCD_PROCESS_STEP		8
+	#define PROF_UART_COMMAND			9
+	#define PROF_UART_SEND_TCU_DATA		10
+
+	#define PROF_COUNT					11	// Количество замеряемых функций.
+	#define PROF_HIST_SIZE				8	// Количество интервалов гистограммы.
+
+	// Замер времени выполнения вызова.
+	#define PROFILE_CALL(N, Call) {uint32_t ProfStart = profiler_start(); Call; profiler_stop(N, ProfStart);}
+
+	// Структура для хранения статистики одной функции.
+	typedef struct PROFILE_t {
+		uint16_t Min;					// Минимальное время, мкс.
+		uint16_t Max;					// Максимальное время, мкс.
+		uint32_t Sum;					// Сумма для расчета среднего.
+		uint16_t Count;					// Количество замеров.
+		uint8_t Hist[PROF_HIST_SIZE];	// Гистограмма по степеням двойки.
+	} PROFILE_t;
+
+	uint32_t profiler_start();
+	void profiler_stop(uint8_t N, uint32_t Start);
+	void profiler_clear();
+
+	uint16_t profiler_get_min(uint8_t N);
+	uint16_t profiler_get_avg(uint8_t N);
+	uint16_t profiler_get_max(uint8_t N);
+	uint8_t profiler_get_hist(uint8_t N, uint8_t Bin);
+
+#endif
+
+/*
+	Время считается по таймеру 2 (шаг 0.5 мкс) и переводится в мкс,
+	значения больше 65535 мкс ограничиваются.
+
+	Интервалы гистограммы, мкс:
+	0 - меньше 16,
+	1 - 16..31,
+	2 - 32..63,
+	3 - 64..127,
+	4 - 128..255,
+	5 - 256..511,
+	6 - 512..1023,
+	7 - 1024 и больше.
+*/
@@ -0,0 +1,117 @@
+#include <stdint.h>			// Коротние название int.
+
+#include "ratio.h"			// Свой заголовок.
+#include "tcudata.h"		// Расчет и хранение всех необходимых параметров.
+#include "configuration.h"	// Настройки.
+#include "timers.h"			// Таймеры.
+
+// Минимальные обороты выходного вала для расчета передаточного числа.
+#define RATIO_MIN_OUTPUT_RPM 150
+// Отклонение оборотов от прежней передачи для начала инерционной фазы.
+#define RATIO_START_RPM 50
+// Отклонение оборотов от новой передачи для синхронизации.
+#define RATIO_SYNC_RPM 35
+// Превышение оборотов над обеими передачами для пробуксовки.
+#define RATIO_FLARE_RPM 100
+// Замедление выходного вала в фазе момента, об/мин за 100 мс.
+#define RATIO_TIEUP_DECEL 50
+
+// Передаточные числа (x1024), на пятой корзина овердрайва стоит.
+static const uint16_t GearRatio[] = {0, GEAR_1_RATIO, GEAR_2_RATIO, GEAR_3_RATIO, GEAR_4_RATIO, 0};
+
+static uint8_t Phase = PHASE_NONE;		// Текущая фаза.
+static uint8_t PhaseFlags = 0;			// Фазы, пройденные в текущем переключении.
+static uint16_t PhaseTime[PHASE_COUNT] = {0};	// Время входа в фазу от начала, мс.
+static uint32_t ShiftStart = 0;			// Время начала переключения, мс.
+
+// Прототипы локальных функций.
+static void ratio_set_phase(uint8_t NewPhase, uint32_t Now);
+
+// Расчет передаточного числа и фазы переключения, вызов каждые 5 мс.
+void ratio_update() {
+	TCU.GearRatio = 0;
+	if (TCU.OutputRPM >= RATIO_MIN_OUTPUT_RPM) {
+		TCU.GearRatio = ((uint32_t) TCU.DrumRPM << 10) / TCU.OutputRPM;
+	}
+
+	int8_t Change = TCU.GearChange;
+	int8_t From = TCU.Gear;
+	int8_t To = From + Change;
+	// На малой скорости фаза не определяется.
+	if (!Change || From < 1 || From > 5 || To < 1 || To > 5 || TCU.OutputRPM < RATIO_MIN_OUTPUT_RPM) {
+		Phase = PHASE_NONE;
+		TCU.ShiftPhase = Phase;
+		return;
+	}
+
+	uint32_t Now = get_time_ms();
+	if (Phase == PHASE_NONE) {ratio_set_phase(PHASE_TORQUE, Now);}
+
+	// Расчетные обороты корзины для прежней и новой передачи.
+	int16_t CalcFrom = ((uint32_t) TCU.OutputRPM * GearRatio[From]) >> 10;
+	int16_t CalcTo = ((uint32_t) TCU.OutputRPM * GearRatio[To]) >> 10;
+	int16_t Drum = TCU.DrumRPM;
+
+	// Отклонение от прежней передачи в сторону новой.
+	int16_t DeltaFrom = (Drum - CalcFrom) * Change;
+	int16_t DeltaTo = Drum - CalcTo;
+	int16_t High = CalcFrom > CalcTo ? CalcFrom : CalcTo;
+
+	if (Drum > High + RATIO_FLARE_RPM) {ratio_set_phase(PHASE_FLARE, Now);}
+	else if (DeltaTo > -RATIO_SYNC_RPM && DeltaTo < RATIO_SYNC_RPM && Phase != PHASE_TORQUE) {
+		ratio_set_phase(PHASE_SYNC, Now);
+	}
+	else if (DeltaFrom < -RATIO_START_RPM) {
+		if (Phase != PHASE_SYNC) {ratio_set_phase(PHASE_INERTIA, Now);}
+	}
+	else if (Phase == PHASE_TORQUE && TCU.OutputRPMDelta < -RATIO_TIEUP_DECEL) {
+		ratio_set_phase(PHASE_TIEUP, Now);
+	}
+	TCU.ShiftPhase = Phase;
+}
+
+// Сброс при запуске процесса переключения.
+void ratio_shift_reset() {
+	Phase = PHASE_NONE;
+	PhaseFlags = 0;
+	ShiftStart = get_time_ms();
+	for (uint8_t i = 0; i < PHASE_COUNT; i++) {PhaseTime[i] = 0;}
+
+	TCU.ShiftPhase = Phase;
+	TCU.ShiftInertiaTime = 0;
+	TCU.ShiftSyncTime = 0;
+}
+
+// Передаточное число передачи (x1024), 0 - не определено.
+uint16_t ratio_gear(int8_t Gear) {
+	if (Gear < 1 || Gear > 5) {return 0;}
+	return GearRatio[Gear];
+}
+
+uint8_t ratio_get_phase() {
+	return Phase;
+}
+
+// Возвращает 1, если фаза была в текущем переключении.
+uint8_t ratio_phase_reached(uint8_t N) {
+	if (N >= PHASE_COUNT) {return 0;}
+	return (PhaseFlags >> N) & 1;
+}
+
+// Время от начала переключения до первого входа в фазу, мс.
+uint16_t ratio_phase_time(uint8_t N) {
+	if (N >= PHASE_COUNT) {return 0;}
+	return PhaseTime[N];
+}
+
+static void ratio_set_phase(uint8_t NewPhase, uint32_t Now) {
+	Phase = NewPhase;
+	if (PhaseFlags & (1 << NewPhase)) {return;}
+
+	PhaseFlags |= (1 << NewPhase);
+	PhaseTime[NewPhase] = Now - ShiftStart;
+
+	// Время начала инерционной фазы и синхронизации в телеметрию.
+	if (NewPhase == PHASE_INERTIA) {TCU.ShiftInertiaTime = PhaseTime[NewPhase];}
+	if (NewPhase == PHASE_SYNC) {TCU.ShiftSyncTime = PhaseTime[NewPhase];}
+}
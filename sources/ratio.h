@@ -0,0 +1,34 @@
+// Фактическое передаточное число и фазы переключения передач.
+
+#ifndef _RATIO_H_
+	#define _RATIO_H_
+
+	// Фазы переключения.
+	#define PHASE_NONE		0	// Нет переключения.
+	#define PHASE_TORQUE	1	// Фаза момента, передаточное число еще прежнее.
+	#define PHASE_INERTIA	2	// Инерционная фаза, передаточное число меняется.
+	#define PHASE_SYNC		3	// Обороты совпали с новой передачей.
+	#define PHASE_FLARE		4	// Обороты входного вала выше обеих передач (пробуксовка).
+	#define PHASE_TIEUP		5	// Замедление выходного вала без изменения передаточного числа.
+	#define PHASE_COUNT		6
+
+	void ratio_update();
+	void ratio_shift_reset();
+	uint8_t ratio_get_phase();
+	uint16_t ratio_gear(int8_t Gear);
+	uint8_t ratio_phase_reached(uint8_t N);
+	uint16_t ratio_phase_time(uint8_t N);
+
+#endif
+
+/*
+	ratio_update вызывается после каждого обновления оборотов валов (5 мс),
+	считает TCU.GearRatio и при TCU.GearChange != 0 определяет фазу переключения
+	с передачи TCU.Gear на TCU.Gear + TCU.GearChange.
+
+	ratio_shift_reset - сброс при запуске процесса переключения,
+	чтобы не использовать фазы предыдущего переключения.
+	ratio_phase_reached - фаза была в текущем переключении.
+	ratio_phase_time - время от начала переключения до первого входа в фазу, мс.
+	ratio_gear - передаточное число от корзины к выходному валу (x1024), на 5 передаче 0.
+*/
@@ -0,0 +1,49 @@
+// Кольцевой буфер с одним писателем и одним читателем.
+
+#ifndef _RINGBUF_H_
+	#define _RINGBUF_H_
+
+	// Объявление буфера, Size - степень двойки, не больше 256.
+	// Пример: static RING_BUFFER(uint16_t, 64) Ring = {};
+	#define RING_BUFFER(Type, Size) struct { \
+		volatile uint8_t Head; \
+		volatile uint8_t Tail; \
+		volatile Type Data[Size]; \
+	}
+
+	#define RING_SIZE(R)		(sizeof((R).Data) / sizeof((R).Data[0]))
+	#define RING_MASK(R)		(RING_SIZE(R) - 1)
+	// Вместимость, при размере 256 один элемент не используется.
+	#define RING_CAPACITY(R)	(RING_SIZE(R) > 128 ? 255 : RING_SIZE(R))
+
+	#define RING_COUNT(R)		((uint8_t) ((R).Head - (R).Tail))
+	#define RING_FREE(R)		(RING_CAPACITY(R) - RING_COUNT(R))
+	#define RING_EMPTY(R)		((R).Head == (R).Tail)
+	#define RING_FULL(R)		(RING_COUNT(R) >= RING_CAPACITY(R))
+
+	// Писатель. Перед записью проверить RING_FULL.
+	#define RING_PUSH(R, Value) do { \
+		(R).Data[(R).Head & RING_MASK(R)] = (Value); \
+		(R).Head++; \
+	} while (0)
+
+	// Читатель. N-й элемент от начала без извлечения и освобождение N элементов.
+	#define RING_PEEK(R, N)		((R).Data[(uint8_t) ((R).Tail + (N)) & RING_MASK(R)])
+	#define RING_COMMIT(R, N)	((R).Tail += (N))
+	#define RING_CLEAR(R)		((R).Tail = (R).Head)
+
+#endif
+
+/*
+	Позиции записи (Head) и чтения (Tail) однобайтные и не ограничиваются размером,
+	индекс элемента получается маской. Количество элементов - разность позиций.
+
+	Head изменяет только писатель, Tail - только читатель,
+	чтение и запись одного байта на AVR атомарны,
+	поэтому запрет прерываний не нужен, если писатель - прерывание,
+	а читатель - основной цикл (или наоборот).
+	Элемент записывается до изменения Head и читается до изменения Tail.
+
+	Для окон усреднения в одном контексте (АЦП, датчики скорости)
+	буфер не нужен, там достаточно массива с позицией.
+*/
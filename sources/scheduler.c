@@ -0,0 +1,122 @@
+#include <stdint.h>			// Коротние название int.
+
+#include "scheduler.h"		// Свой заголовок.
+
+static TASK_t* Tasks;				// Таблица задач.
+static uint8_t TasksCount = 0;		// Количество задач в таблице.
+
+static uint16_t SchedulerTime = 0;	// Шкала времени планировщика, мс.
+static uint8_t RetryFlag = 0;		// Задача просит повторный запуск.
+static volatile uint8_t CurrentTask = 255;	// Выполняемая задача.
+
+// Прототипы локальных функций.
+static uint8_t task_allowed(TASK_t* Task, uint8_t State);
+static void task_skip(TASK_t* Task);
+
+// Инициализация планировщика, необходимо передать таблицу задач.
+void scheduler_init(TASK_t* Table, uint8_t Count) {
+	Tasks = Table;
+	TasksCount = Count;
+	SchedulerTime = 0;
+
+	for (uint8_t i = 0; i < TasksCount; i++) {
+		Tasks[i].NextRun = Tasks[i].Offset;
+		Tasks[i].MaxJitter = 0;
+		Tasks[i].Overruns = 0;
+	}
+}
+
+// Продвижение шкалы времени.
+void scheduler_tick(uint8_t TimerAdd) {
+	SchedulerTime += TimerAdd;
+}
+
+// Запуск одной готовой задачи, возвращает номер задачи или 255.
+uint8_t scheduler_run(uint8_t State) {
+	uint8_t N = 255;
+
+	for (uint8_t i = 0; i < TasksCount; i++) {
+		// Время запуска еще не наступило.
+		if ((int16_t) (SchedulerTime - Tasks[i].NextRun) < 0) {continue;}
+
+		// Задача запрещена в текущем состоянии,
+		// пропускаем её запуски без учета в статистике.
+		if (!task_allowed(&Tasks[i], State)) {
+			task_skip(&Tasks[i]);
+			continue;
+		}
+
+		if (N == 255 || Tasks[i].Priority < Tasks[N].Priority) {N = i;}
+	}
+	if (N == 255) {return N;}
+
+	TASK_t* Task = &Tasks[N];
+	uint16_t Jitter = SchedulerTime - Task->NextRun;
+
+	RetryFlag = 0;
+	CurrentTask = N;
+	Task->Function();
+	CurrentTask = 255;
+	if (RetryFlag) {return N;}	// Задача не выполнена, остается готовой.
+
+	if (Jitter > Task->MaxJitter) {Task->MaxJitter = Jitter;}
+
+	Task->NextRun += Task->Period;
+	// Пропущенные периоды не навёрстываем.
+	while ((int16_t) (SchedulerTime - Task->NextRun) >= 0) {
+		Task->NextRun += Task->Period;
+		if (Task->Overruns < UINT16_MAX) {Task->Overruns++;}
+	}
+	return N;
+}
+
+// Вызывается из задачи, если её нужно повторить на следующей итерации.
+void scheduler_retry() {
+	RetryFlag = 1;
+}
+
+// Запуск задачи на ближайшей итерации, не дожидаясь периода.
+void scheduler_wake(void (*Function)()) {
+	for (uint8_t i = 0; i < TasksCount; i++) {
+		if (Tasks[i].Function == Function) {
+			Tasks[i].NextRun = SchedulerTime;
+			return;
+		}
+	}
+}
+
+// Номер выполняемой задачи или 255 вне задачи.
+uint8_t scheduler_get_current() {
+	return CurrentTask;
+}
+
+uint8_t scheduler_get_count() {
+	return TasksCount;
+}
+
+uint16_t scheduler_get_jitter(uint8_t N) {
+	if (N >= TasksCount) {return 0;}
+	return Tasks[N].MaxJitter;
+}
+
+uint16_t scheduler_get_overruns(uint8_t N) {
+	if (N >= TasksCount) {return 0;}
+	return Tasks[N].Overruns;
+}
+
+void scheduler_clear_stats() {
+	for (uint8_t i = 0; i < TasksCount; i++) {
+		Tasks[i].MaxJitter = 0;
+		Tasks[i].Overruns = 0;
+	}
+}
+
+static uint8_t task_allowed(TASK_t* Task, uint8_t State) {
+	if ((State & SCHED_STATE_SHIFT) && !(Task->Flags & TASK_RUN_IN_SHIFT)) {return 0;}
+	if ((State & SCHED_STATE_NO_CONTROL) && !(Task->Flags & TASK_RUN_NO_CONTROL)) {return 0;}
+	return 1;
+}
+
+static void task_skip(TASK_t* Task) {
+	while ((int16_t) (SchedulerTime - Task->NextRun) >= 0) {Task->NextRun += Task->Period;}
+}
@@ -0,0 +1,52 @@
+// Планировщик задач.
+
+#ifndef _SCHEDULER_H_
+	#define _SCHEDULER_H_
+
+	// Флаги задачи.
+	#define TASK_RUN_IN_SHIFT		(1 << 0)	// Выполнять во время переключения передачи.
+	#define TASK_RUN_NO_CONTROL		(1 << 1)	// Выполнять без управления АКПП (двигатель заглушен, ручной режим).
+
+	// Текущее состояние ЭБУ для отбора задач.
+	#define SCHED_STATE_SHIFT		(1 << 0)	// Идет переключение передачи.
+	#define SCHED_STATE_NO_CONTROL	(1 << 1)	// Управление АКПП отключено.
+
+	// Структура задачи.
+	typedef struct TASK_t {
+		void (*Function)();		// Функция задачи.
+		uint16_t Period;		// Период запуска, мс.
+		uint16_t Offset;		// Смещение первого запуска, мс.
+		uint8_t Priority;		// Приоритет, 0 - наивысший.
+		uint8_t Flags;			// Флаги задачи.
+		uint16_t NextRun;		// Время следующего запуска, мс.
+		uint16_t MaxJitter;		// Максимальное опоздание запуска, мс.
+		uint16_t Overruns;		// Количество пропущенных периодов.
+	} TASK_t;
+
+	void scheduler_init(TASK_t* Table, uint8_t Count);
+	void scheduler_tick(uint8_t TimerAdd);
+	uint8_t scheduler_run(uint8_t State);
+	void scheduler_retry();
+	void scheduler_wake(void (*Function)());
+	uint8_t scheduler_get_current();
+
+	uint8_t scheduler_get_count();
+	uint16_t scheduler_get_jitter(uint8_t N);
+	uint16_t scheduler_get_overruns(uint8_t N);
+	void scheduler_clear_stats();
+
+#endif
+
+/*
+	Задачи запускаются от общей шкалы времени (мс).
+	Время следующего запуска увеличивается на период задачи,
+	а не отсчитывается от момента запуска, поэтому период не "плывет".
+
+	За один вызов scheduler_run выполняется только одна задача,
+	из готовых выбирается задача с наивысшим приоритетом.
+	Остальные готовые задачи выполняются в следующих итерациях цикла,
+	опоздание запуска фиксируется в MaxJitter.
+
+	Если задача опоздала больше чем на период, пропущенные запуски
+	не выполняются, а учитываются в счетчике Overruns.
+*/
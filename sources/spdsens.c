@@ -1,9 +1,12 @@
+#include <avr/io.h>				// Названия регистров и номера бит.
 #include <avr/interrupt.h>		// Прерывания.
 #include <stdint.h>				// Коротние название int.
 
 #include "spdsens.h"			// Свой заголовок.
 #include "tcudata.h"			// Расчет и хранение всех необходимых параметров.
 #include "configuration.h"		// Настройки.
+#include "events.h"				// Очередь событий от прерываний.
+#include "critical.h"			// Критические секции.
 
 // Минимальное сырое значения для фильтрации ошибочных значений.
 // Шаг 4мкс (1/64).
@@ -14,19 +17,69 @@
 #define MIN_RAW_VALUE_OD 1040
 #define MIN_RAW_VALUE_OUT 1380
 
-// Размер буфера и размер битового сдвига для деления.
-#define SENSOR_BUFFER_SIZE 32 + 4
-#define SENSOR_BUFFER_SHIFT 5
+// Количество переполнений таймера без фронтов до признака отсутствия сигнала.
+// Переполнение каждые 32.8 мс, 16 - около 0.5 с.
+#define SENSOR_TIMEOUT_OVF 16
+#define SENSOR_TIMEOUT_TICKS ((uint32_t) SENSOR_TIMEOUT_OVF << 16)
 
-// Кольцевые буферы для замера оборотов, прохождение 1 зуба шагах таймера (4 мкс).
-volatile uint16_t DrumArray[SENSOR_BUFFER_SIZE] = {0};
-volatile uint16_t OutputArray[SENSOR_BUFFER_SIZE] = {0};
-// Текущая позиция в буфере.
-volatile uint8_t DrumPos = 0;
-volatile uint8_t OutputPos = 0;
-// Признак готовности буфера для записи.
-volatile uint8_t DrumBufferReady = 1;
-volatile uint8_t OutputBufferReady = 1;
+// Максимальный размер окна усреднения, степень двойки.
+#define SENSOR_BUFFER_SIZE 32
+// Шагов таймера в 1 мс.
+#define SENSOR_TICKS_PER_MS 2000UL
+
+// Штраф за отброшенный период и порог переобучения.
+// Каждый принятый период уменьшает штраф на 1.
+#define SENSOR_REJECT_PENALTY 4
+#define SENSOR_REJECT_LIMIT 16
+// Количество периодов без проверки после переобучения.
+#define SENSOR_RELEARN_EDGES 8
+// Максимальный допуск периода, %. При большем допуске диапазоны
+// одного и двух пропущенных зубов перекрываются.
+#define SENSOR_GLITCH_TOL_MAX 30
+
+// Окно замеров датчика, прохождение 1 зуба в шагах таймера.
+typedef struct SENSOR_t {
+	uint32_t Array[SENSOR_BUFFER_SIZE];	// Замеры после медианного фильтра.
+	uint8_t Pos;						// Текущая позиция в окне.
+	uint32_t Prev[2];					// Два предыдущих сырых замера.
+	uint16_t Ovf;						// Старшее слово времени (счетчик переполнений).
+	uint8_t Idle;						// Переполнений с последнего фронта.
+	uint8_t Started;					// Время предыдущего фронта известно.
+	uint8_t Penalty;					// Штраф за отброшенные периоды.
+	uint8_t Relearn;					// Периодов до включения проверки.
+	// Читаются в основном цикле.
+	volatile uint32_t LastTime;			// Время предыдущего фронта.
+	volatile uint32_t Sum;				// Сумма значений в окне.
+	volatile uint8_t Count;				// Количество замеров в окне.
+	volatile uint8_t MinCount;			// Минимальное количество замеров для расчета.
+	volatile uint16_t Lost;				// Потерянные фронты.
+	volatile uint16_t Rejected;			// Отброшенные фронты (помехи).
+	volatile uint16_t Missing;			// Восстановленные пропуски зубов.
+	volatile uint16_t Edges;			// Принятые фронты.
+	volatile uint8_t Seq;				// Номер изменения.
+} SENSOR_t;
+
+// Изменяются только в прерываниях, прерывания при чтении не запрещаются,
+// согласованность значений проверяется по номеру изменения Seq.
+static SENSOR_t Drum = {};
+static SENSOR_t Output = {};
+
+// Коэффициент спидометра (x4096), 0 - OCR3A из прерывания не обновляется.
+static volatile uint16_t SpeedometerCoef = 0;
+
+// Прототипы локальных функций.
+static uint32_t sensor_get_avg(SENSOR_t* Sensor);
+static uint32_t sensor_now(SENSOR_t* Sensor);
+static void sensor_get_diag(SENSOR_t* Sensor, uint16_t* Lost, uint16_t* Rejected, uint16_t* Missing, uint16_t* Edges);
+static uint32_t sensor_time(SENSOR_t* Sensor, uint16_t Count, uint8_t Overflow);
+static uint8_t sensor_edge(SENSOR_t* Sensor, uint32_t Time, uint16_t Latency, uint16_t MinPeriod, uint8_t Tolerance);
+static void sensor_reject(SENSOR_t* Sensor);
+static void sensor_push(SENSOR_t* Sensor, uint32_t Value);
+static void sensor_trim(SENSOR_t* Sensor, uint8_t Time, uint8_t Min, uint8_t Max);
+static uint8_t sensor_overflow(SENSOR_t* Sensor);
+#ifdef SPEED2_OUT_ENABLED
+	static void speed2_update(uint8_t Teeth);
+#endif
 
 // Расчет скорости корзины овердрайва АКПП.
 uint16_t get_overdrive_drum_rpm() {
@@ -37,39 +90,11 @@ uint16_t get_overdrive_drum_rpm() {
 	//#define PRM_CALC_COEF_OD 937500UL	// Шаг 4мкс (1/64).
 	#define PRM_CALC_COEF_OD 7500000UL	// Шаг 0.5мкс (1/8).
 
-	DrumBufferReady = 0;	// Запрещаем обновление буфера в прерываниях.
-
-	// Переменные для хранения двух крайних значений.
-	uint16_t MaxValue = DrumArray[0];
-	uint16_t MaxValuePrev = DrumArray[0];
-	
-	uint16_t MinValue = DrumArray[0];
-	uint16_t MinValuePrev = DrumArray[0];
-
-	uint32_t AVG = 0;
-	// Суммируем среднее и ищем крайние значения.
-	for (uint8_t i = 0; i < SENSOR_BUFFER_SIZE; i++) {
-		AVG += DrumArray[i];
-
-		if (DrumArray[i] < MinValue) {
-			MinValuePrev = MinValue;
-			MinValue = DrumArray[i];
-		}
-		if (DrumArray[i] > MaxValue) {
-			MaxValuePrev = MaxValue;
-			MaxValue = DrumArray[i];
-		}
-	}
-	DrumBufferReady = 1;	// Разрешаем обновление буфера в прерываниях.
-
-	// Исключаем два самых больших и два самых маленьких значения.
-	AVG -= (MaxValue + MaxValuePrev + MinValue + MinValuePrev);
-	// Находим среднее значение.
-	AVG = AVG >> SENSOR_BUFFER_SHIFT;
+	uint32_t AVG = sensor_get_avg(&Drum);
 
 	// Рассчитываем обороты вала.
 	uint16_t RPM = 0;
-	if (AVG < UINT16_MAX) {RPM = (uint32_t) PRM_CALC_COEF_OD / AVG;}
+	if (AVG) {RPM = PRM_CALC_COEF_OD / AVG;}
 	return RPM;
 }
 
@@ -81,84 +106,369 @@ uint16_t get_output_shaft_rpm() {
 	//#define PRM_CALC_COEF_OUT 1250000UL		// Шаг 4мкс (1/64).
 	#define PRM_CALC_COEF_OUT 10000000UL		// Шаг 0.5мкс (1/8).
 
-	OutputBufferReady = 0;	// Запрещаем обновление буфера в прерываниях.
+	uint32_t AVG = get_output_shaft_period();
+
+	// Рассчитываем обороты вала.
+	uint16_t RPM = 0;
+	if (AVG) {RPM = PRM_CALC_COEF_OUT / AVG;}
+	return RPM;
+}
+
+// Средний период зуба выходного вала, шаг 0.5 мкс, 0 - нет сигнала.
+uint32_t get_output_shaft_period() {
+	return sensor_get_avg(&Output);
+}
+
+// Коэффициент пересчета периода зуба в значение OCR3A (x4096).
+// При 0 спидометром управляет основной цикл.
+void spdsens_set_speedometer(uint16_t Coef) {
+	CRITICAL_BEGIN();
+		SpeedometerCoef = Coef;
+	CRITICAL_END();
+}
+
+// Диагностика датчиков скорости в TCU, вызов каждую 1 с.
+void spdsens_diag_update() {
+	static uint16_t DrumEdges = 0;
+	static uint16_t OutputEdges = 0;
+	uint16_t Edges = 0;
 
-	// Переменные для хранения двух крайних значений.
-	uint16_t MaxValue = OutputArray[0];
-	uint16_t MaxValuePrev = OutputArray[0];
-	
-	uint16_t MinValue = OutputArray[0];
-	uint16_t MinValuePrev = OutputArray[0];
+	sensor_get_diag(&Drum, &TCU.DrumLost, &TCU.DrumRejected, &TCU.DrumMissing, &Edges);
+	TCU.DrumEdgeRate = Edges - DrumEdges;
+	DrumEdges = Edges;
 
-	uint32_t AVG = 0;
-	// Суммируем среднее и ищем крайние значения.
-	for (uint8_t i = 0; i < SENSOR_BUFFER_SIZE; i++) {
-		AVG += OutputArray[i];
+	sensor_get_diag(&Output, &TCU.OutputLost, &TCU.OutputRejected, &TCU.OutputMissing, &Edges);
+	TCU.OutputEdgeRate = Edges - OutputEdges;
+	OutputEdges = Edges;
+}
+
+// Время свободного счета таймера 5 (0.5 мкс), расширенное до 32 бит.
+uint32_t spdsens_get_time() {
+	return sensor_now(&Output);
+}
+
+// Среднее значение по окну, 0 - нет сигнала.
+static uint32_t sensor_get_avg(SENSOR_t* Sensor) {
+	uint32_t Now = 0;
+	uint32_t Sum = 0;
+	uint32_t LastTime = 0;
+	uint8_t Count = 0;
+	uint8_t MinCount = 0;
+	uint8_t Seq = 0;
+
+	// Если во время чтения сработало прерывание, читаем заново.
+	do {
+		Seq = Sensor->Seq;
+		Sum = Sensor->Sum;
+		LastTime = Sensor->LastTime;
+		Count = Sensor->Count;
+		MinCount = Sensor->MinCount;
+		// Текущее время после чтения, фронт между ними изменит Seq.
+		Now = sensor_now(Sensor);
+	} while (Seq != Sensor->Seq);
+
+	if (!Count || Count < MinCount) {return 0;}
+
+	// Устаревание по возрасту последнего фронта.
+	uint32_t Age = Now - LastTime;
+	if ((int32_t) Age < 0) {Age = 0;}
+	if (Age >= SENSOR_TIMEOUT_TICKS) {return 0;}
+
+	// Фронта нет уже дольше двух периодов - вал замедляется,
+	// период не меньше прошедшего времени.
+	uint32_t AVG = Sum / Count;
+	if (Age > AVG * 2) {AVG = Age;}
+	return AVG;
+}
+
+static void sensor_get_diag(SENSOR_t* Sensor, uint16_t* Lost, uint16_t* Rejected, uint16_t* Missing, uint16_t* Edges) {
+	uint8_t Seq = 0;
+
+	do {
+		Seq = Sensor->Seq;
+		*Lost = Sensor->Lost;
+		*Rejected = Sensor->Rejected;
+		*Missing = Sensor->Missing;
+		*Edges = Sensor->Edges;
+	} while (Seq != Sensor->Seq);
+}
 
-		if (OutputArray[i] < MinValue) {
-			MinValuePrev = MinValue;
-			MinValue = OutputArray[i];
+// Текущее время таймера датчика.
+static uint32_t sensor_now(SENSOR_t* Sensor) {
+	uint32_t Now = 0;
+	CRITICAL_BEGIN();
+		// Сначала счетчик, потом флаг переполнения, как в прерываниях по захвату.
+		uint16_t Count = 0;
+		uint8_t Overflow = 0;
+		if (Sensor == &Drum) {
+			Count = TCNT4;
+			Overflow = TIFR4 & (1 << TOV4);
 		}
-		if (OutputArray[i] > MaxValue) {
-			MaxValuePrev = MaxValue;
-			MaxValue = OutputArray[i];
+		else {
+			Count = TCNT5;
+			Overflow = TIFR5 & (1 << TOV5);
 		}
+		Now = sensor_time(Sensor, Count, Overflow);
+	CRITICAL_END();
+	return Now;
+}
+
+// Время по счетчику таймера Count с расширением до 32 бит.
+// Overflow - флаг переполнения, вызов при запрещенных прерываниях.
+static uint32_t sensor_time(SENSOR_t* Sensor, uint16_t Count, uint8_t Overflow) {
+	uint16_t High = Sensor->Ovf;
+	// Переполнение было до захвата, но его прерывание еще не обработано.
+	if (Overflow && Count < 0x8000) {High++;}
+	return ((uint32_t) High << 16) | Count;
+}
+
+// Обработка фронта, вызов из прерывания по захвату.
+// Time - время фронта, Latency - время от фронта до входа в прерывание,
+// Tolerance - допустимое отклонение от ожидаемого периода, %.
+// Возвращает количество прошедших зубов, 0 - помеха.
+static uint8_t sensor_edge(SENSOR_t* Sensor, uint32_t Time, uint16_t Latency, uint16_t MinPeriod, uint8_t Tolerance) {
+	// Первый фронт после отсутствия сигнала, период еще не известен.
+	if (!Sensor->Started || Sensor->Idle >= SENSOR_TIMEOUT_OVF) {
+		Sensor->Seq++;
+		Sensor->Started = 1;
+		Sensor->LastTime = Time;
+		Sensor->Idle = 0;
+		Sensor->Sum = 0;
+		Sensor->Pos = 0;
+		Sensor->Count = 0;
+		return 1;
 	}
-	OutputBufferReady = 1;	// Разрешаем обновление буфера в прерываниях.
 
-	// Исключаем два самых больших и два самых маленьких значения.
-	AVG -= (MaxValue + MaxValuePrev + MinValue + MinValuePrev);
-	// Находим среднее значение.
-	AVG = AVG >> SENSOR_BUFFER_SHIFT;
+	uint32_t Value = Time - Sensor->LastTime;
+	// Слишком короткий период - помеха. Время предыдущего фронта
+	// не меняется, следующий фронт даст полный период.
+	if (Value <= MinPeriod) {
+		sensor_reject(Sensor);
+		return 0;
+	}
 
-	// Рассчитываем обороты вала.
-	uint16_t RPM = 0;
-	if (AVG < UINT16_MAX) {RPM = (uint32_t) PRM_CALC_COEF_OUT / AVG;}
-	return RPM;
+	// Количество зубов, прошедших за период.
+	uint8_t Teeth = 1;
+
+	// Не заданное значение из старой EEPROM (255) ограничивается.
+	if (Tolerance > SENSOR_GLITCH_TOL_MAX) {Tolerance = SENSOR_GLITCH_TOL_MAX;}
+
+	// Проверка по ожидаемому периоду - последнему значению в окне.
+	if (Tolerance && !Sensor->Relearn && Sensor->Count >= Sensor->MinCount) {
+		uint32_t Expected = Sensor->Array[(Sensor->Pos - 1) & (SENSOR_BUFFER_SIZE - 1)];
+		// Допуск Expected * Tolerance / 100 без деления, 41 / 4096 = 0.01.
+		uint32_t Tol = ((Expected >> 4) * Tolerance * 41) >> 8;
+
+		if (Value + Tol < Expected) {
+			// Лишний фронт, как и короткий период.
+			sensor_reject(Sensor);
+			return 0;
+		}
+		if (Value > Expected + Tol) {
+			// Период кратен ожидаемому - пропущен один или два зуба.
+			if (Value + 2 * Tol >= 2 * Expected && Value <= 2 * (Expected + Tol)) {Teeth = 2;}
+			else if (Value + 3 * Tol >= 3 * Expected && Value <= 3 * (Expected + Tol)) {Teeth = 3;}
+			else {
+				// Длинный период без кратности в окно не попадает,
+				// но следующий период отсчитывается от этого фронта.
+				Sensor->LastTime = Time;
+				Sensor->Idle = 0;
+				sensor_reject(Sensor);
+				return 1;
+			}
+		}
+	}
+
+	Sensor->LastTime = Time;
+	Sensor->Idle = 0;
+	Sensor->Seq++;
+	Sensor->Edges++;
+	if (Sensor->Penalty) {Sensor->Penalty--;}
+	if (Sensor->Relearn) {Sensor->Relearn--;}
+
+	// Пропущенные зубы заменяются средним периодом.
+	if (Teeth > 1) {
+		Value = (Teeth == 2) ? Value >> 1 : Value / 3;
+		if (Sensor->Missing < UINT16_MAX - 2) {Sensor->Missing += Teeth - 1;}
+	}
+
+	// Задержка прерывания больше периода - за это время
+	// был как минимум еще один фронт, регистр захвата перезаписан.
+	if (Latency >= Value && Sensor->Lost < UINT16_MAX) {Sensor->Lost++;}
+
+	for (uint8_t i = 0; i < Teeth; i++) {sensor_push(Sensor, Value);}
+	return Teeth;
+}
+
+// Учет отброшенного фронта, вызов из прерывания по захвату.
+static void sensor_reject(SENSOR_t* Sensor) {
+	Sensor->Seq++;
+	if (Sensor->Rejected < UINT16_MAX) {Sensor->Rejected++;}
+
+	// Отбрасывается слишком много - вероятно, изменилась сама скорость,
+	// на время заполнения окна проверка по ожидаемому периоду отключается.
+	Sensor->Penalty += SENSOR_REJECT_PENALTY;
+	if (Sensor->Penalty >= SENSOR_REJECT_LIMIT) {
+		Sensor->Penalty = 0;
+		Sensor->Relearn = SENSOR_RELEARN_EDGES;
+	}
+}
+
+// Добавление периода в окно, вызов из прерывания по захвату.
+static void sensor_push(SENSOR_t* Sensor, uint32_t Value) {
+	// Первый замер после отсутствия сигнала.
+	if (!Sensor->Count) {
+		Sensor->Prev[0] = Value;
+		Sensor->Prev[1] = Value;
+	}
+
+	// Медиана по трем последним замерам,
+	// одиночный выброс (пропуск или лишний фронт) в окно не попадает.
+	uint32_t A = Sensor->Prev[1];
+	uint32_t B = Sensor->Prev[0];
+	uint32_t Median = Value;
+	if ((A <= B && B <= Value) || (Value <= B && B <= A)) {Median = B;}
+	else if ((B <= A && A <= Value) || (Value <= A && A <= B)) {Median = A;}
+	Sensor->Prev[1] = B;
+	Sensor->Prev[0] = Value;
+
+	// Окно заполнено, самое старое значение вычитается из суммы.
+	if (Sensor->Count < SENSOR_BUFFER_SIZE) {Sensor->Count++;}
+	else {Sensor->Sum -= Sensor->Array[Sensor->Pos];}
+
+	Sensor->Array[Sensor->Pos] = Median;
+	Sensor->Sum += Median;
+	Sensor->Pos = (Sensor->Pos + 1) & (SENSOR_BUFFER_SIZE - 1);
+}
+
+// Подгонка окна по времени, вызов из прерывания по захвату.
+// В окне остается минимум зубов, перекрывающих Time мс, но не меньше Min и не больше Max.
+static void sensor_trim(SENSOR_t* Sensor, uint8_t Time, uint8_t Min, uint8_t Max) {
+	if (Max > SENSOR_BUFFER_SIZE) {Max = SENSOR_BUFFER_SIZE;}
+	if (Min > Max) {Min = Max;}
+	if (!Min) {Min = 1;}
+	Sensor->MinCount = Min;
+
+	uint32_t Window = Time * SENSOR_TICKS_PER_MS;
+	// Самое старое значение в окне.
+	uint8_t Tail = (Sensor->Pos - Sensor->Count) & (SENSOR_BUFFER_SIZE - 1);
+
+	// Обычно убирается не больше одного значения за вызов.
+	while (Sensor->Count > Min) {
+		uint32_t Oldest = Sensor->Array[Tail];
+		if (Sensor->Count <= Max && Sensor->Sum - Oldest < Window) {break;}
+
+		Sensor->Sum -= Oldest;
+		Sensor->Count--;
+		Tail = (Tail + 1) & (SENSOR_BUFFER_SIZE - 1);
+	}
+}
+
+// Переполнение таймера, вызов из прерывания.
+// Только счетчики, окно очищается при следующем фронте,
+// устаревание значений определяется при чтении.
+// Возвращает 1 в момент пропадания сигнала.
+static uint8_t sensor_overflow(SENSOR_t* Sensor) {
+	Sensor->Ovf++;
+
+	if (Sensor->Idle >= SENSOR_TIMEOUT_OVF) {return 0;}
+	Sensor->Idle++;
+	if (Sensor->Idle < SENSOR_TIMEOUT_OVF) {return 0;}
+	return 1;
 }
 
+#ifdef SPEED2_OUT_ENABLED
+	// Делитель по умолчанию для не заданных значений из старой EEPROM (255).
+	#define SPEED2_DEFAULT_DIVIDER 8
+	#define SPEED2_DEFAULT_HIGH 4
+
+	// Второй выход скорости, делитель по зубам выходного вала, вызов из прерывания по захвату.
+	// Из CFG.Speed2Divider зубов первые CFG.Speed2High выход в уровне HIGH.
+	// OC3C в режиме переключения, уровень меняется записью FOC3C без обращения к порту.
+	static void speed2_update(uint8_t Teeth) {
+		static uint8_t Count = 0;
+		static uint8_t Level = 0;
+
+		uint8_t Div = CFG.Speed2Divider;
+		uint8_t High = CFG.Speed2High;
+		if (Div == 255) {
+			Div = SPEED2_DEFAULT_DIVIDER;
+			High = SPEED2_DEFAULT_HIGH;
+		}
+		// Иначе выход постоянно в уровне HIGH.
+		if (High >= Div) {High = Div >> 1;}
+
+		uint8_t NewLevel = 0;
+		if (Div) {
+			uint16_t Next = Count + Teeth;
+			while (Next >= Div) {Next -= Div;}
+			Count = Next;
+			NewLevel = (Count < High);
+		}
+
+		if (NewLevel != Level) {
+			TCCR3C = (1 << FOC3C);
+			Level = NewLevel;
+		}
+	}
+#endif
+
+// Таймеры 4 и 5 работают без сброса, время фронта расширяется
+// до 32 бит счетчиком переполнений, период - разность времени фронтов.
 
 // Корзина овердрайва.
 // Прерывание по захвату сигнала таймером 4.
 ISR (TIMER4_CAPT_vect) {
-	TCNT4 = 0;				// Обнулить счётный регистр.
+	uint16_t Latency = TCNT4;
+	uint16_t Capture = ICR4;
+	Latency -= Capture;
 
-	if (DrumBufferReady && ICR4 > MIN_RAW_VALUE_OD) {
-		// Записываем значение в кольцевой буфер.	
-		DrumArray[DrumPos] = ICR4;
-		DrumPos++;
-		if (DrumPos >= SENSOR_BUFFER_SIZE) {DrumPos = 0;}
-	}
+	uint32_t Time = sensor_time(&Drum, Capture, TIFR4 & (1 << TOV4));
+	sensor_edge(&Drum, Time, Latency, MIN_RAW_VALUE_OD, CFG.SpeedGlitchTol);
+	sensor_trim(&Drum, CFG.DrumAvgTime, CFG.DrumAvgMin, CFG.DrumAvgMax);
 }
 // Прерывание по переполнению таймера 4.
 ISR (TIMER4_OVF_vect) {
-	for (uint8_t i = 0; i < SENSOR_BUFFER_SIZE; i++) {
-		DrumArray[i] = UINT16_MAX;
-	}
+	if (sensor_overflow(&Drum)) {events_push(EVENT_DRUM_TIMEOUT, 0);}
 }
 
 // Выходной вал.
 // Прерывание по захвату сигнала таймером 5.
 ISR (TIMER5_CAPT_vect) {
-	TCNT5 = 0;						// Обнулить счётный регистр.
-	if (OutputBufferReady && ICR5 > MIN_RAW_VALUE_OUT) {
-		// Записываем значение в кольцевой буфер.	
-		OutputArray[OutputPos] = ICR5;
-		OutputPos++;
-		if (OutputPos >= SENSOR_BUFFER_SIZE) {OutputPos = 0;}
+	uint16_t Latency = TCNT5;
+	uint16_t Capture = ICR5;
+	Latency -= Capture;
+
+	uint32_t Time = sensor_time(&Output, Capture, TIFR5 & (1 << TOV5));
+	uint8_t Teeth = sensor_edge(&Output, Time, Latency, MIN_RAW_VALUE_OUT, CFG.SpeedGlitchTol);
+	#ifdef SPEED2_OUT_ENABLED
+		speed2_update(Teeth);	// Сразу после фронта, задержка от фронта постоянная.
+	#endif
+	sensor_trim(&Output, CFG.OutputAvgTime, CFG.OutputAvgMin, CFG.OutputAvgMax);
+
+	// Частота спидометра пропорциональна скорости, значит OCR3A - периоду зуба.
+	// Берется последний период после медианы, стрелка сама сглаживает изменения.
+	// Период больше 16 бит бывает только на малой скорости, тогда OCR3A задает основной цикл.
+	if (SpeedometerCoef && Output.Count) {
+		uint32_t Period = Output.Array[(Output.Pos - 1) & (SENSOR_BUFFER_SIZE - 1)];
+		if (Period < 0x10000UL) {
+			uint32_t Value = (Period * SpeedometerCoef) >> 12;
+			// Чтобы не было пропуска при уменьшении значения.
+			// 0xFFFF не используется, иначе сработает совпадение OCR3C.
+			if (Value > 0 && Value < 0xFFFF && TCNT3 < Value) {OCR3A = Value;}
+		}
 	}
 
-	// Подсчет пробега в оборотах выходного вала.
+	// Подсчет пробега в оборотах выходного вала по прошедшим зубам,
+	// помехи не считаются, восстановленные пропуски учитываются.
 	static uint8_t MCounter = 0;
-	MCounter++;
+	MCounter += Teeth;
 	if (MCounter >= OUTPUT_SHAFT_TEETH_COUNT) {
 		APP.RevCounter++;
-		MCounter = 0;
+		MCounter -= OUTPUT_SHAFT_TEETH_COUNT;
 	}
 }
 // Прерывание по переполнению таймера 5.
 ISR (TIMER5_OVF_vect) {
-	for (uint8_t i = 0; i < SENSOR_BUFFER_SIZE; i++) {
-		OutputArray[i] = UINT16_MAX;
-	}
-}
\ No newline at end of file
+	if (sensor_overflow(&Output)) {events_push(EVENT_OUTPUT_TIMEOUT, 0);}
+}
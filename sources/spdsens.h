@@ -4,5 +4,9 @@
 
 	uint16_t get_overdrive_drum_rpm();
 	uint16_t get_output_shaft_rpm();
+	uint32_t get_output_shaft_period();
+	uint32_t spdsens_get_time();
+	void spdsens_set_speedometer(uint16_t Coef);
+	void spdsens_diag_update();
 	
 #endif
\ No newline at end of file
@@ -0,0 +1,60 @@
+#include <stdint.h>			// Коротние название int.
+#include <avr/io.h>			// Названия регистров и номера бит.
+
+#include "stack.h"			// Свой заголовок.
+#include "tcudata.h"		// Расчет и хранение всех необходимых параметров.
+#include "configuration.h"	// Настройки.
+
+// Символы компоновщика.
+extern uint8_t __data_start;	// Начало .data.
+extern uint8_t __bss_end;		// Конец .bss.
+extern uint8_t __heap_start;	// Начало свободной памяти.
+
+// Порог по умолчанию, если настройка не записана в EEPROM (0xFFFF).
+#define STACK_MIN_FREE_DEFAULT 256
+
+// Нижняя граница использованного стека.
+static volatile uint8_t* StackMark = (uint8_t*) (RAMEND + 1);
+// Текущая позиция проверки.
+static volatile uint8_t* ScanPos = &__heap_start;
+
+// Заполнение свободной памяти при запуске, выполняется до main.
+// Указатель стека уже установлен на RAMEND, .bss еще не очищена.
+void stack_paint() __attribute__ ((naked, used, section(".init3")));
+void stack_paint() {
+	uint8_t* P = &__heap_start;
+	while (P < (uint8_t*) SP) {*P++ = STACK_CANARY;}
+}
+
+// Поиск нижней границы стека, вызов периодически.
+void stack_check() {
+	for (uint8_t i = 0; i < STACK_SCAN_STEP; i++) {
+		if (ScanPos >= StackMark) {
+			ScanPos = &__heap_start;	// Граница не изменилась, начинаем сначала.
+			break;
+		}
+		if (*ScanPos != STACK_CANARY) {
+			StackMark = ScanPos;		// Стек опустился ниже.
+			ScanPos = &__heap_start;
+			break;
+		}
+		ScanPos++;
+	}
+
+	TCU.StackFree = stack_get_free();
+	TCU.StaticRAM = stack_get_static();
+	uint16_t MinFree = CFG.StackMinFree;
+	if (MinFree == 0xFFFF) {MinFree = STACK_MIN_FREE_DEFAULT;}
+	if (TCU.StackFree < MinFree) {TCU.StackLow = 1;}
+	else {TCU.StackLow = 0;}
+}
+
+// Минимальный запас свободной памяти за время работы, байт.
+uint16_t stack_get_free() {
+	return StackMark - &__heap_start;
+}
+
+// Размер статических данных .data и .bss, байт.
+uint16_t stack_get_static() {
+	return &__bss_end - &__data_start;
+}
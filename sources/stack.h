@@ -0,0 +1,26 @@
+// Контроль свободной памяти стека.
+
+#ifndef _STACK_H_
+	#define _STACK_H_
+
+	#define STACK_CANARY		0xc5	// Значение для заполнения свободной памяти.
+	#define STACK_SCAN_STEP		128		// Количество байт проверки за один вызов.
+
+	void stack_check();
+	uint16_t stack_get_free();
+	uint16_t stack_get_static();
+
+#endif
+
+/*
+	При запуске (секция .init3, до инициализации .data и .bss)
+	свободная память от конца .bss до вершины стека заполняется значением STACK_CANARY.
+
+	stack_check выполняет проверку частями по STACK_SCAN_STEP байт
+	от конца .bss вверх, до первого измененного байта.
+	Так находится наибольшая глубина стека за время работы.
+	Результат копируется в TCU:
+		StackFree - минимальный запас между стеком и .bss, байт,
+		StaticRAM - размер .data и .bss, байт,
+		StackLow - запас меньше CFG.StackMinFree.
+*/
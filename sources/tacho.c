@@ -1,16 +1,34 @@
-//Нештатный код/patch
-
 #include <avr/interrupt.h>		// Прерывания.
+#include <avr/io.h>				// Названия регистров и номера бит.
 #include <stdint.h>				// Коротние название int.
 #include "tacho.h"				// Свой заголовок.
+#include "critical.h"			// Критические секции.
 #include "configuration.h"		// Настройки.
 #include "tcudata.h"			// Расчет и хранение всех необходимых параметров.
-
-volatile uint16_t TachoImps = 0;
+#include "spdsens.h"			// Датчики скорости валов.
+
+// Период расчета оборотов, мс.
+#define TACHO_CALC_PERIOD 10
+// Шагов таймера 5 (0.5 мкс) в 1 мс.
+#define TACHO_TICKS_PER_MS 2000UL
+// Нет импульсов дольше 200 мс - обороты 0.
+#define TACHO_TIMEOUT (200 * TACHO_TICKS_PER_MS)
+// Наибольшее время усреднения 500 мс.
+#define TACHO_MAX_SPAN (500 * TACHO_TICKS_PER_MS)
+// Количество цилиндров, если настройка не записана или ошибочна.
+#define TACHO_DEFAULT_CYLINDERS 4
+
+// Время последних импульсов по таймеру 5, степень двойки.
+#define TACHO_BUFFER_SIZE 16
+static volatile uint32_t TachoTimes[TACHO_BUFFER_SIZE] = {0};
+static volatile uint8_t TachoPos = 0;
+static volatile uint8_t TachoCount = 0;		// Количество импульсов в буфере.
 
 uint8_t TachoEW = 0;
 uint16_t TachoTimer = 0;
 
+static uint16_t tacho_get_rpm();
+
 // Инициализация внешнего прерывания INT4 по спаду фронта.
 void tacho_init() {
 	#ifndef USE_ENGINE_RPM
@@ -31,14 +49,9 @@ void tacho_timer(uint8_t TimerAdd) {
 
 	TachoTimer += TimerAdd;		// Счетчик времени.
 
-	if (TachoTimer >= 500) {	// Расчет оборотов каждые 500 мс.
-		uint16_t Imps = 0;
-		cli();
-			Imps = TachoImps;
-			TachoImps = 0;
-		sei();
-
-		TCU.EngineRPM = Imps * 60;
+	if (TachoTimer >= TACHO_CALC_PERIOD) {
+		TCU.EngineRPM = tacho_get_rpm();
+		calculate_converter_slip();		// Проскальзывание ГТ по свежим оборотам.
 		TachoTimer = 0;
 	}
 
@@ -53,9 +66,63 @@ uint8_t get_tacho_ew() {
 	return TachoEW;
 }
 
+// Обороты по времени последних CFG.TachoAvgPulses периодов.
+static uint16_t tacho_get_rpm() {
+	// Старые значения EEPROM (0xFF) ограничиваются.
+	uint8_t N = CFG.TachoAvgPulses;
+	if (N < 1) {N = 1;}
+	if (N > TACHO_BUFFER_SIZE - 1) {N = TACHO_BUFFER_SIZE - 1;}
+	uint8_t Cylinders = CFG.TachoCylinders;
+	if (!Cylinders || Cylinders > 16) {Cylinders = TACHO_DEFAULT_CYLINDERS;}
+
+	uint32_t Times[TACHO_BUFFER_SIZE];
+	uint32_t Now = 0;
+	uint8_t Count = 0;
+	CRITICAL_BEGIN();
+		Count = TachoCount;
+		// При запуске усредняем по тому, что есть.
+		if (N >= Count) {N = Count - 1;}
+		for (uint8_t i = 0; i <= N && i < Count; i++) {
+			Times[i] = TachoTimes[(TachoPos - 1 - i) & (TACHO_BUFFER_SIZE - 1)];
+		}
+		Now = spdsens_get_time();
+	CRITICAL_END();
+
+	if (Count < 2) {return 0;}
+	uint32_t Last = Times[0];
+
+	// Импульсов давно не было, начинаем набор заново.
+	if (Now - Last > TACHO_TIMEOUT) {
+		CRITICAL_BEGIN();
+			TachoCount = 0;
+		CRITICAL_END();
+		return 0;
+	}
+
+	// Периоды от последнего импульса, пока общее время не больше TACHO_MAX_SPAN,
+	// на малых оборотах периодов меньше.
+	// Каждый период меньше TACHO_TIMEOUT, иначе буфер уже был бы сброшен.
+	uint32_t Span = 0;
+	uint8_t Used = 0;
+	for (uint8_t i = 1; i <= N; i++) {
+		uint32_t Period = Times[i - 1] - Times[i];
+		if (Span + Period > TACHO_MAX_SPAN) {break;}
+		Span += Period;
+		Used++;
+	}
+	if (!Span) {return 0;}
+
+	// Импульс на каждый рабочий ход, Cylinders импульсов за 2 оборота, шаг таймера 0.5 мкс.
+	// [Обороты] = 60 * 2 * 2000000 * N / ([Время N периодов, шаги] * [Цилиндры]).
+	#define TACHO_CALC_COEF 240000000UL
+	return (TACHO_CALC_COEF * Used) / (Span * Cylinders);
+}
+
 // Обработчик прерывания для INT4
 ISR (INT4_vect) {
-	TachoImps++;
+	TachoTimes[TachoPos] = spdsens_get_time();
+	TachoPos = (TachoPos + 1) & (TACHO_BUFFER_SIZE - 1);
+	if (TachoCount < TACHO_BUFFER_SIZE) {TachoCount++;}
 }
 
 
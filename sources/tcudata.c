@@ -5,12 +5,15 @@
 #include "tcudata_tables.h"		// Таблицы TCUData.
 
 #include "spdsens.h"			// Датчики скорости валов.
+#include "ratio.h"				// Передаточное число и фазы переключения.
+#include "fusion.h"				// Совместная фильтрация оборотов валов.
 #include "adc.h"				// АЦП.
 #include "macros.h"				// Макросы.
 #include "configuration.h"		// Настройки.
 #include "mathemat.h"			// Математические функции.
 #include "pinout.h"				// Список назначенных выводов.
 #include "bmp180.h"				// Модуль измерения давления.
+#include "critical.h"			// Критические секции.
 
 // Инициализация структуры с переменными.
 TCU_t TCU = {
@@ -56,7 +59,33 @@ TCU_t TCU = {
 	.RawOIL = 0,
 	.AdaptationFlagTPS = 0,
 	.AdaptationFlagTemp = 0,
-	.ManualModeTimer = 0
+	.ManualModeTimer = 0,
+	.CPULoad = 0,
+	.LoopRate = 0,
+	.Timestamp = 0,
+	.TimestampSub = 0,
+	.GearChangeStart = 0,
+	.GearChangeTime = 0,
+	.StackFree = 0,
+	.StaticRAM = 0,
+	.StackLow = 0,
+	.DrumLost = 0,
+	.OutputLost = 0,
+	.OutputRPMDelta = 0,
+	.DrumRejected = 0,
+	.DrumMissing = 0,
+	.DrumEdgeRate = 0,
+	.OutputRejected = 0,
+	.OutputMissing = 0,
+	.OutputEdgeRate = 0,
+	.GearRatio = 0,
+	.ShiftPhase = 0,
+	.ShiftInertiaTime = 0,
+	.ShiftSyncTime = 0,
+	.CarSpeedFine = 0,
+	.TurbineRPM = 0,
+	.ConverterSlip = 0,
+	.UartDropped = 0
 };
 
 APP_t APP = {
@@ -66,33 +95,97 @@ APP_t APP = {
 
 uint8_t SpeedTestFlag = 0;	// Флаг включения тестирования скорости.
 
+// История оборотов для расчета ускорения, замер каждые 5 мс.
+#define RPM_HISTORY_SIZE 16
+static uint16_t DrumHistory[RPM_HISTORY_SIZE] = {0};
+static uint16_t OutputHistory[RPM_HISTORY_SIZE] = {0};
+static uint8_t HistoryPos = 0;
+// Средний период зуба выходного вала, шаг 0.5 мкс.
+static uint32_t OutputPeriod = 0;
+
 // Прототипы локальных функций.
 static uint16_t get_car_speed();
+static uint16_t get_turbine_rpm();
+static int16_t get_rpm_slope(uint16_t* History);
 
 static int16_t get_cell_adapt_step(uint8_t N, int16_t Value, int16_t LeftCell, int8_t GridStep, int16_t AdaptStep);
 
 // Расчет параметров на основе датчиков и таблиц.
 void calculate_tcu_data() {
-	static uint8_t Counter = 0;
-	static uint16_t PrevDrumRPM = 0;
-
-	TCU.DrumRPM = get_overdrive_drum_rpm();
-	TCU.OutputRPM = get_output_shaft_rpm();
-	TCU.CarSpeed = get_car_speed();
-
 	TCU.OilTemp = get_oil_temp();
 
 	TCU.S1 = PIN_READ(SOLENOID_S1_PIN) ? 1 : 0;
 	TCU.S2 = PIN_READ(SOLENOID_S2_PIN) ? 1 : 0;
 	TCU.S3 = PIN_READ(SOLENOID_S3_PIN) ? 1 : 0;
 	TCU.S4 = PIN_READ(SOLENOID_S4_PIN) ? 1 : 0;
+}
 
-	Counter++;
-	if (Counter >= 2) {
-		Counter = 0;
-		TCU.DrumRPMDelta = (TCU.DrumRPM - PrevDrumRPM);
-		PrevDrumRPM = TCU.DrumRPM;
+// Обороты валов и скорость авто, вызов каждые 5 мс.
+// Среднее по окну считается в прерываниях датчиков, здесь только деление.
+void calculate_shaft_speed() {
+	TCU.DrumRPM = get_overdrive_drum_rpm();
+	TCU.OutputRPM = get_output_shaft_rpm();
+	OutputPeriod = get_output_shaft_period();
+	TCU.CarSpeedFine = get_car_speed();
+	TCU.CarSpeed = MIN(255, (TCU.CarSpeedFine + 50) / 100);
+
+	// Ускорение валов по 16 последним замерам (75 мс).
+	DrumHistory[HistoryPos] = TCU.DrumRPM;
+	OutputHistory[HistoryPos] = TCU.OutputRPM;
+	HistoryPos = (HistoryPos + 1) & (RPM_HISTORY_SIZE - 1);
+	if (fusion_enabled()) {
+		fusion_update();	// Фильтр заменяет обороты и ускорение валов.
+	}
+	else {
+		TCU.DrumRPMDelta = get_rpm_slope(DrumHistory);
+		TCU.OutputRPMDelta = get_rpm_slope(OutputHistory);
 	}
+
+	TCU.TurbineRPM = get_turbine_rpm();
+
+	ratio_update();		// Передаточное число и фаза переключения.
+}
+
+// Наклон прямой по методу наименьших квадратов, об/мин за 100 мс.
+static int16_t get_rpm_slope(uint16_t* History) {
+	// Замеры через равные промежутки, поэтому веса постоянные:
+	// K = 2 * i - (N - 1), от -15 до 15 для самого старого и нового.
+	// Наклон на шаг = Sum(K * RPM) / (2 * Sum(x^2)) = Sum / 680,
+	// 20 шагов по 5 мс в 100 мс, итоговый делитель 680 / 20 = 34.
+	#define RPM_SLOPE_DIV 34
+
+	int32_t Sum = 0;
+	int8_t K = 1 - RPM_HISTORY_SIZE;
+	for (uint8_t i = 0; i < RPM_HISTORY_SIZE; i++) {
+		Sum += (int32_t) K * History[(HistoryPos + i) & (RPM_HISTORY_SIZE - 1)];
+		K += 2;
+	}
+	return Sum / RPM_SLOPE_DIV;
+}
+
+// Проскальзывание гидротрансформатора, вызов после каждого расчета оборотов двигателя (10 мс).
+void calculate_converter_slip() {
+	if (!TCU.EngineRPM) {
+		TCU.ConverterSlip = 0;
+		return;
+	}
+	TCU.ConverterSlip = MAX(-32000, MIN(32000, (int32_t) TCU.EngineRPM - TCU.TurbineRPM));
+}
+
+// Обороты турбины (входного вала).
+static uint16_t get_turbine_rpm() {
+	// Водило планетарного ряда овердрайва связано с входным валом, солнце - с корзиной,
+	// эпицикл - с промежуточным валом. На 1-4 передачах ряд заблокирован (C0)
+	// и корзина вращается с входным валом. На 5 передаче корзина стоит (B0).
+	// [Вход] = [Корзина] * (1 - K) + [Промежуточный вал] * K, K = 0.753 (x1024).
+	// На 4 и 5 передачах промежуточный вал вращается с выходным,
+	// поэтому формула верна и во время переключения 4-5 и 5-4.
+	#define OD_RATIO (((uint32_t) GEAR_5_RATIO << 10) / GEAR_4_RATIO)
+
+	if (TCU.Gear == 5 || (TCU.Gear == 4 && TCU.GearChange == 1)) {
+		return ((uint32_t) TCU.DrumRPM * (1024 - OD_RATIO) + (uint32_t) TCU.OutputRPM * OD_RATIO) >> 10;
+	}
+	return TCU.DrumRPM;
 }
 
 // Расчет скорости авто.
@@ -104,8 +197,13 @@ static uint16_t get_car_speed() {
 	// Умножаем на 8192 (смещение 13 бит) = 227.2132617,
 	// Округляем до целого и получается 114.
 
-	if (SpeedTestFlag) {return 100;}
-	else {return ((uint32_t) TCU.OutputRPM * CFG.SpeedCalcCoef) >> 13;}
+	// Скорость считается сразу по периоду зуба выходного вала с шагом 0.01 км/ч,
+	// [Обороты] = 10000000 / [Период], [Скорость x100] = 1000000000 / 8192 * Коэф / [Период].
+	#define SPEED_PERIOD_COEF (1000000000UL >> 13)
+
+	if (SpeedTestFlag) {return 10000;}
+	if (!OutputPeriod) {return 0;}
+	return ((uint32_t) SPEED_PERIOD_COEF * CFG.SpeedCalcCoef) / OutputPeriod;
 }
 
 // Расчет значения регистра сравнения для таймера спидометра.
@@ -124,7 +222,31 @@ uint16_t get_speed_timer_value() {
 		else {return 0;}
 	}
 
-	return ((uint32_t) SPEED_FREQ_COEF / ((uint32_t) CFG.SpeedImpulsPerKM * Speed));
+	uint32_t Value = (uint32_t) SPEED_FREQ_COEF / ((uint32_t) CFG.SpeedImpulsPerKM * Speed);
+	// Значение ограничивается до усечения в 16 бит,
+	// 0xFFFF не используется, иначе сработает совпадение OCR3C.
+	if (Value > 0xFFFE) {Value = 0xFFFE;}
+	return Value;
+}
+
+// Коэффициент пересчета периода зуба выходного вала в значение OCR3A (x4096)
+// для обновления спидометра в прерывании по каждому фронту, 0 - обновление из основного цикла.
+uint16_t get_speedometer_coef() {
+	// [OCR3A] = 125000 * 3600 / ([Импульсов на км] * [Скорость]), скорость обратна периоду,
+	// [OCR3A] = [Период] * 125000 * 3600 * 8192 / (10000000 * [Импульсов на км] * Коэф).
+	// С умножением на 4096 итоговая константа 1509949440.
+	#define SPEEDOMETER_PERIOD_COEF 1509949440UL
+	// Период зуба, выше которого OCR3A задает основной цикл (16 мс).
+	#define SPEEDOMETER_MAX_PERIOD 0x8000UL
+
+	if (SpeedTestFlag || TCU.CarSpeed < 2) {return 0;}
+	if (!OutputPeriod || OutputPeriod >= SPEEDOMETER_MAX_PERIOD) {return 0;}
+
+	uint32_t Div = (uint32_t) CFG.SpeedImpulsPerKM * CFG.SpeedCalcCoef;
+	if (!Div) {return 0;}
+	uint32_t Coef = SPEEDOMETER_PERIOD_COEF / Div;
+	if (Coef > 0xFFFF) {return 0;}
+	return Coef;
 }
 
 // Расчет температуры масла.
@@ -164,7 +286,23 @@ void calc_tps() {
 
 // Возвращает пробег в метрах из оборотов.
 uint32_t get_meters_count() {
-	return ((uint32_t) (APP.RevCounter >> 8) * CFG.MeterCalcCoef);
+	return ((uint32_t) (get_rev_counter() >> 8) * CFG.MeterCalcCoef);
+}
+
+// Счетчик оборотов выходного вала увеличивается в прерывании,
+// поэтому чтение и запись только с запретом прерываний.
+uint32_t get_rev_counter() {
+	uint32_t Value = 0;
+	CRITICAL_BEGIN();
+		Value = APP.RevCounter;
+	CRITICAL_END();
+	return Value;
+}
+
+void set_rev_counter(uint32_t Value) {
+	CRITICAL_BEGIN();
+		APP.RevCounter = Value;
+	CRITICAL_END();
 }
 
 uint16_t get_slt_pressure() {
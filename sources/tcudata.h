@@ -4,10 +4,15 @@
 	#define _TCUDATA_H_
 
 	void calculate_tcu_data();
+	void calculate_shaft_speed();
+	void calculate_converter_slip();
 	uint16_t get_speed_timer_value();
+	uint16_t get_speedometer_coef();
 	int16_t get_oil_temp();
 	void calc_tps();
 	uint32_t get_meters_count();
+	uint32_t get_rev_counter();
+	void set_rev_counter(uint32_t Value);
 
 	uint16_t get_slt_pressure();
 	int16_t get_slt_temp_corr(int16_t Value);
@@ -39,7 +44,7 @@
 	typedef struct TCU_t {
 		uint16_t EngineRPM;			// Обороты двигателя.
 		uint16_t DrumRPM;			// Обороты корзины овердрайва.
-		int16_t DrumRPMDelta;		// Скорость изменения оборотов корзины овердрайва.		
+		int16_t DrumRPMDelta;		// Скорость изменения оборотов корзины овердрайва, об/мин за 100 мс.		
 		uint16_t OutputRPM;			// Обороты выходного вала.
 		uint8_t CarSpeed;			// Скорость автомобиля.
 		uint32_t MeterCounter;		// Пробег в метрах.
@@ -80,6 +85,32 @@
 		int8_t AdaptationFlagTPS;	// Флаг срабатывания адаптации по ДПДЗ.
 		int8_t AdaptationFlagTemp;	// Флаг срабатывания адаптации по температуре.
 		uint16_t ManualModeTimer;	// Режим ручного переключения передач (Типтроник).
+		uint8_t CPULoad;			// Загрузка процессора, %.
+		uint16_t LoopRate;			// Частота основного цикла, циклов/с.
+		uint32_t Timestamp;			// Время отправки пакета, мс.
+		uint8_t TimestampSub;		// Доля миллисекунды времени отправки (10 мкс).
+		uint32_t GearChangeStart;	// Время начала последнего переключения, мс.
+		uint16_t GearChangeTime;	// Длительность последнего переключения, мс.
+		uint16_t StackFree;			// Минимальный запас памяти стека, байт.
+		uint16_t StaticRAM;			// Размер .data и .bss, байт.
+		uint8_t StackLow;			// Запас памяти стека меньше допустимого.
+		uint16_t DrumLost;			// Потерянные фронты датчика корзины овердрайва.
+		uint16_t OutputLost;		// Потерянные фронты датчика выходного вала.
+		int16_t OutputRPMDelta;		// Скорость изменения оборотов выходного вала, об/мин за 100 мс.
+		uint16_t DrumRejected;		// Отброшенные фронты датчика корзины овердрайва.
+		uint16_t DrumMissing;		// Восстановленные пропуски зубов корзины овердрайва.
+		uint16_t DrumEdgeRate;		// Фронтов датчика корзины овердрайва в секунду.
+		uint16_t OutputRejected;	// Отброшенные фронты датчика выходного вала.
+		uint16_t OutputMissing;		// Восстановленные пропуски зубов выходного вала.
+		uint16_t OutputEdgeRate;	// Фронтов датчика выходного вала в секунду.
+		uint16_t GearRatio;			// Фактическое передаточное число (x1024).
+		uint8_t ShiftPhase;			// Фаза текущего переключения.
+		uint16_t ShiftInertiaTime;	// Начало инерционной фазы от начала переключения, мс.
+		uint16_t ShiftSyncTime;		// Синхронизация оборотов от начала переключения, мс.
+		uint16_t CarSpeedFine;		// Скорость автомобиля, 0.01 км/ч.
+		uint16_t TurbineRPM;		// Расчетные обороты турбины (входного вала).
+		int16_t ConverterSlip;		// Проскальзывание гидротрансформатора, обороты двигателя - турбины.
+		uint16_t UartDropped;		// Пакеты UART, не поместившиеся в очередь отправки.
 	} TCU_t;
 	extern struct TCU_t TCU; 	// Делаем структуру с параметрами внешней.
 
@@ -8,6 +8,9 @@
 #include "pinout.h"			// Список назначенных выводов.
 #include "tcudata.h"		// Расчет и хранение всех необходимых параметров.
 #include "gears.h"			// Фунции переключения передач.
+#include "pressure.h"		// Управление давлением соленоидов.
+#include "critical.h"		// Критические секции.
+#include "spdsens.h"		// Датчики скорости валов.
 
 // Прототипы локальных функций.
 static void engine_brake_solenoid();
@@ -16,12 +19,8 @@ static void engine_brake_solenoid();
 void slt_control() {
 	if (TCU.DebugMode == 2) {return;}
 
-	if (!TCU.EngineWork) {TCU.SLT = 1023;}
-	else {TCU.SLT = get_slt_pressure();}
-
-	cli();
-		OCR1A = TCU.SLT;	// SLT - выход A таймера 1.
-	sei();
+	if (!TCU.EngineWork) {pressure_set(PRESSURE_SLT, 1023);}
+	else {pressure_set(PRESSURE_SLT, get_slt_pressure());}
 }
 
 void at_mode_control() {
@@ -78,6 +77,10 @@ void at_mode_control() {
 		return;
 	}
 	
+	// Во время переключения передачи остальные режимы
+	// применяются после его завершения.
+	if (gear_change_active()) {return;}
+
 	if (TCU.Selector == 2) {
 		// Задняя скорость включается только стоя на тормозе,
 		// или без тормоза, но с режима P.
@@ -147,10 +150,7 @@ void glock_control(uint8_t Timer) {
 		if (TCU.Glock) {
 			// При отпускании педали газа сразу отключаем блокировку ГТ.
 			if (TCU.InstTPS <= CFG.IdleTPSLimit) {
-				TCU.SLU = CFG.MinPressureSLU;
-				cli();
-					OCR1C = TCU.SLU;
-				sei();
+				pressure_set(PRESSURE_SLU, CFG.MinPressureSLU);
 				TCU.Glock = 0;
 				GTimer = 0;
 				return;
@@ -159,22 +159,20 @@ void glock_control(uint8_t Timer) {
 			// Начальное значение схватывания с учетом температурной коррекции.
 			SLUStartValue = CFG.GlockStartValue + get_slu_gear2_temp_corr(CFG.GlockStartValue);
 			
-			if (TCU.SLU > SLUStartValue + 20) {
+			uint16_t SLU = pressure_get(PRESSURE_SLU);
+			if (SLU > SLUStartValue + 20) {
 				// Устанавливаем давление схватывания + 20.
-				TCU.SLU = SLUStartValue + 20;
+				pressure_set(PRESSURE_SLU, SLUStartValue + 20);
 			}
-			else if (TCU.SLU > SLUStartValue - 20) {
-				// Плавно снижаем на 10 единиц.
-				TCU.SLU -= 8;
+			else if (SLU > SLUStartValue - 20) {
+				// Плавно снижаем, 8 единиц за 100 мс.
+				if (!pressure_ramp_active(PRESSURE_SLU)) {pressure_slope(PRESSURE_SLU, SLUStartValue - 20, 80);}
 			}
 			else {
 				// Потом выключаем полностью.
 				TCU.Glock = 0;
-				TCU.SLU = CFG.MinPressureSLU;
+				pressure_set(PRESSURE_SLU, CFG.MinPressureSLU);
 			}
-			cli();
-				OCR1C = TCU.SLU;	// Применение значения.
-			sei();
 		}
 		GTimer = 0;
 		return;
@@ -185,18 +183,18 @@ void glock_control(uint8_t Timer) {
 		if (!TCU.Glock) {
 			// Начальное значение схватывания с учетом температурной коррекции.
 			SLUStartValue = CFG.GlockStartValue + get_slu_gear2_temp_corr(CFG.GlockStartValue);
-			TCU.SLU = SLUStartValue;
+			pressure_set(PRESSURE_SLU, SLUStartValue);
 			TCU.Glock = 1;
 		}
 		else {
-			if (TCU.SLU >= CFG.GlockWorkValue) {return;}
-			uint8_t PressureAdd = 20;
-			if (TCU.SLU < SLUStartValue + 60) {PressureAdd = 4;}
-			TCU.SLU = MIN(CFG.GlockWorkValue, TCU.SLU + PressureAdd);
+			if (pressure_ramp_active(PRESSURE_SLU)) {return;}
+
+			uint16_t SLU = pressure_get(PRESSURE_SLU);
+			if (SLU >= CFG.GlockWorkValue) {return;}
+			// До схватывания медленно, 4 единицы за 100 мс, потом 20 единиц за 100 мс.
+			if (SLU < SLUStartValue + 60) {pressure_slope(PRESSURE_SLU, MIN(CFG.GlockWorkValue, SLUStartValue + 60), 40);}
+			else {pressure_slope(PRESSURE_SLU, CFG.GlockWorkValue, 200);}
 		}
-		cli();
-			OCR1C = TCU.SLU;	// Применение значения.
-		sei();
 	}
 }
 
@@ -227,12 +225,18 @@ void rear_lamp() {
 
 void speedometer_control() {
 	uint16_t NewValue = get_speed_timer_value();
+	// Выше 2 км/ч OCR3A обновляется в прерывании датчика выходного вала.
+	uint16_t Coef = get_speedometer_coef();
+	spdsens_set_speedometer(Coef);
+
 	if (NewValue > 0) {
 		TCCR3A |= (1 << COM3A0);			// Toggle OC3A.
 		// Чтобы не было пропуска при уменьшении значения.
-		cli();
-			if (TCNT3 < NewValue) {OCR3A = NewValue;}
-		sei();
+		if (!Coef) {
+			CRITICAL_BEGIN();
+				if (TCNT3 < NewValue) {OCR3A = NewValue;}
+			CRITICAL_END();
+		}
 	}
 	else {TCCR3A &= ~(1 << COM3A0);}		// Normal port operation, OCnA/OCnB/OCnC disconnected.
 }
\ No newline at end of file
@@ -1,7 +1,15 @@
+#include <stdint.h>			// Коротние название int.
 #include <avr/io.h>			// Номера бит в регистрах.
+#include <avr/interrupt.h>	// Прерывания.
 
 #include "configuration.h"	// Настройки.
 #include "timers.h"			// Свой заголовок.
+#include "macros.h"			// Макросы.
+#include "pinout.h"			// Список назначенных выводов.
+
+extern volatile uint16_t CycleTimer;		// Счетчик времени 10.5 мкс из main.
+extern volatile uint32_t SystemTime;		// Время от включения из main.
+extern volatile uint16_t SystemTimeMark;	// Значение CycleTimer в начале миллисекунды.
 
 static void timer_0_init();
 static void timer_1_init();
@@ -13,12 +21,46 @@ static void timer_5_init();
 void timers_init() {
 	timer_0_init();		// Настройка таймера 0 как счетчик времени (1 мс).
 	timer_1_init();		// Настройка таймера 1 как ШИМ для соленоидов.
-	timer_2_init();		// Настройка таймера 2 как счетчик времени (10 мкс) для проверки времени цикла.
+	timer_2_init();		// Настройка таймера 2 как счетчик времени (10.5 мкс) для проверки времени цикла.
 	timer_3_init();		// Настройка таймера 3 как ШИМ для спидометра (выход).
 	timer_4_init();		// Настройка таймера 4 для измерения скорости корзины овердрайва.
 	timer_5_init();		// Настройка таймера 5 для измерения скорости выходного вала.	
 }
 
+// Время от включения, мс.
+uint32_t get_time_ms() {
+	uint32_t Ms = 0;
+	uint8_t SaveSREG = SREG;
+	cli();
+		Ms = SystemTime;
+		// Миллисекунда прошла, а прерывание еще не обработано.
+		if (TIFR0 & (1 << OCF0A)) {Ms++;}
+	SREG = SaveSREG;
+	return Ms;
+}
+
+// Метка времени, миллисекунды и доля миллисекунды в единицах 10 мкс.
+void get_timestamp(uint32_t* Ms, uint8_t* Sub) {
+	uint32_t Time = 0;
+	uint16_t Ticks = 0;
+	uint8_t SaveSREG = SREG;
+	cli();
+		Time = SystemTime;
+		Ticks = CycleTimer - SystemTimeMark;
+		if (TIFR0 & (1 << OCF0A)) {
+			Time++;
+			Ticks = 0;
+		}
+	SREG = SaveSREG;
+
+	// Шаги CycleTimer (10.5 мкс) в единицы 10 мкс, 269 / 256 = 1.05.
+	// Ограничение до умножения, чтобы не было переполнения 16 бит.
+	Ticks = (MIN(Ticks, 200) * 269U) >> 8;
+
+	*Ms = Time;
+	*Sub = MIN(Ticks, 99);
+}
+
 // Настройка таймера 0 как счетчик времени (1 мс).
 static void timer_0_init() {
 	TCCR0A = 0;
@@ -29,8 +71,7 @@ static void timer_0_init() {
 	TCCR0A |= (1 << WGM01);					// Сброс счетчика при совпадении.
 	TCCR0B |= (1 << CS01) | (1 << CS00);  	// Делитель x64.
 
-	// -2 это коррекция из-за неточной частоты конкретной платы.
-	OCR0A = 249 - 2;						// Регистр сравнения.
+	OCR0A = TIMER0_TOP;						// Регистр сравнения.
 							
 	// Прерывание по достижению OCR0A.
 	TIMSK0|= (1 << OCIE0A);				
@@ -66,9 +107,10 @@ static void timer_1_init() {
 	#endif
 
 	TCCR1B |= (1 << CS11) | (1 << CS10);		// Предделитель 64.
+	TIMSK1 |= (1 << TOIE1);						// Прерывание по переполнению для изменения давления.
 }
 
-// Настройка таймера 2 как счетчик времени (10 мкс) для проверки времени цикла.
+// Настройка таймера 2 как счетчик времени (10.5 мкс) для проверки времени цикла.
 static void timer_2_init() {
 	TCCR2A = 0;
 	TCCR2B = 0;
@@ -77,7 +119,7 @@ static void timer_2_init() {
 
 	TCCR2A |= (1 << WGM21);			// Сброс счетчика при совпадении.
 	TCCR2B |= (1 << CS21);  		// Делитель x8.
-	OCR2A = 20;						// Регистр сравнения.
+	OCR2A = CYCLE_TIMER_STEPS - 1;	// Регистр сравнения.
 	TIMSK2|= (1 << OCIE2A);			// Прерывание по достижению OCR2A.
 }
 
@@ -93,6 +135,15 @@ static void timer_3_init() {
 
 	TCCR3B |= (1 << WGM32);					// CTC, TOP = OCR3A.
 	TCCR3A |= (1 << COM3A0);				// Toggle OC3A.
+
+	#ifdef SPEED2_OUT_ENABLED
+		// Второй выход скорости, уровень переключается только принудительно (FOC3C)
+		// из прерывания датчика выходного вала, совпадение с OCR3C не наступает.
+		SET_PIN_MODE_OUTPUT(SPEED2_OUT_PIN);	// Выход PE5 OC3C.
+		OCR3C = 0xFFFF;
+		TCCR3A |= (1 << COM3C0);			// Toggle OC3C.
+	#endif
+
 	TCCR3B |= (1 << CS31) | (1 << CS30);	// Предделитель 64.
 }
 
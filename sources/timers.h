@@ -3,6 +3,27 @@
 #ifndef _TIMERS_H_
 	#define _TIMERS_H_
 
+	// Регистр сравнения таймера 0, -2 это коррекция из-за неточной частоты конкретной платы.
+	// Шаг 4 мкс, период системного тика (249 - 2 + 1) * 4 = 992 мкс.
+	#define TIMER0_TOP (249 - 2)
+	#define SYSTEM_TICK_US ((TIMER0_TOP + 1) * 4UL)
+
+	// Таймер 2 считает от 0 до OCR2A включительно, шаг 0.5 мкс,
+	// шаг счетчика CycleTimer 21 * 0.5 = 10.5 мкс.
+	#define CYCLE_TIMER_STEPS 21
+	#define CYCLE_TIMER_STEP_NS (CYCLE_TIMER_STEPS * 500UL)
+
 	void timers_init();
 
-#endif
\ No newline at end of file
+	uint32_t get_time_ms();
+	void get_timestamp(uint32_t* Ms, uint8_t* Sub);
+
+#endif
+
+/*
+	Время от включения ЭБУ считается в прерывании таймера 0 (1 мс),
+	доля миллисекунды - по счетчику CycleTimer (шаг 10.5 мкс),
+	пересчитанная в единицы 10 мкс, значения 0..99.
+	Функции чтения времени сохраняют состояние прерываний,
+	поэтому их можно вызывать и из обработчиков прерываний.
+*/
\ No newline at end of file
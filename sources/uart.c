@@ -11,6 +11,13 @@
 #include "gears.h"			// Фунции переключения передач.
 #include "selector.h"		// Положение селектора АКПП.
 #include "configuration.h"	// Настройки.
+#include "profiler.h"		// Замер времени выполнения функций.
+#include "scheduler.h"		// Планировщик задач.
+#include "timers.h"			// Таймеры.
+#include "critical.h"		// Критические секции.
+#include "watchdog.h"		// Сторожевой таймер.
+#include "events.h"			// Очередь событий от прерываний.
+#include "ringbuf.h"		// Кольцевой буфер.
 
 #include <stdio.h>			// Стандартная библиотека ввода/вывода
 
@@ -35,12 +42,15 @@ volatile uint8_t RxMarkerByte = 0;					// Признак, что предыду
 
 #define UART_TX_BUFFER_SIZE 200						// Размер буфера отправки.
 uint8_t	SendBuffer[UART_TX_BUFFER_SIZE] = {0};		// Буфер отправки.
-uint16_t TxMsgSize = 0;								// Количество байт для отправки.
-volatile uint8_t TxBuffPos = 0;						// Позиция в буфере.
-volatile uint8_t TxReady = 1;						// UART готов к отправке.
+uint8_t TxBuffPos = 0;								// Позиция в буфере.
 
-volatile uint8_t UseMarkers = 0;	// Использовать спецсимволы начала/конца пакета.
-volatile uint8_t TxMarkerByte = 0;	// Признак, что предыдущий символ был заменен.
+// Очередь отправки, каждый пакет - байт длины и сам пакет без замены спецсимволов.
+// Спецсимволы заменяются в прерывании при отправке.
+static RING_BUFFER(uint8_t, 256) TxRing = {};
+static volatile uint8_t TxSize = 0;					// Размер отправляемого пакета.
+static volatile uint8_t TxLeft = 0;					// Осталось отправить байт пакета.
+static volatile uint8_t TxMarkerByte = 0;			// Символ-замена после символа подмены.
+static uint16_t TxDropped = 0;						// Пакеты, не поместившиеся в очередь.
 
 char CharArray[8] = {0};
 
@@ -53,13 +63,14 @@ static volatile uint8_t CurrUART = 0;	// Номер активного UART.
 static volatile uint8_t NextUART = 0;	// Номер следующего UART.
 
 static void uart_udre_vect();
-static void uart_tx_vect();
 static void uart_rx_vect();
 
 static void uart_buffer_add_uint8(uint8_t Value);
 
 static void uart_buffer_add_uint16(uint16_t Value);
 static void uart_buffer_add_int16(int16_t Value);
+static void uart_buffer_add_uint32(uint32_t Value);
+static void uart_buffer_add_timestamp();
 
 static void uart_write_table(uint8_t N);
 
@@ -70,6 +81,9 @@ static uint32_t uart_build_uint32(uint8_t i);
 static void uart_write_cfg_data();
 static void uart_send_ports_state();
 static void uart_send_version();
+static void uart_send_profile(uint8_t Page);
+static void uart_send_critical(uint8_t Page);
+static void uart_send_events();
 
 // Функция программного сброса
 void(* resetFunc) (void) = 0;
@@ -99,14 +113,12 @@ void uart_init(uint8_t mode) {
 			break;
 		case 2:
 			UCSR0B |= (1 << TXEN0);		// 2 - Только передача.
-			UCSR0B |= (1 << TXCIE0);	// Прерывание по завершеию передачи.
 			break;
 		case 3:
 			// 3 - прием / передача.
 			UCSR0B |= (1 << TXEN0);		// Прием.
 			UCSR0B |= (1 << RXEN0);		// Передача.
 			UCSR0B |= (1 << RXCIE0);	// Прерывание по завершеию приёма.
-			UCSR0B |= (1 << TXCIE0);	// Прерывание по завершеию передачи.
 			break;
 	}
 
@@ -120,7 +132,7 @@ void uart_init(uint8_t mode) {
 }
 
 void uart_send_tcu_data() {
-	if (!TxReady) {return;}		// Не трогать буффер пока идет передача.
+	if (!uart_tx_ready()) {return;}		// Не трогать буффер пока идет передача.
 
 	if (SendPortsStateCount) {
 		SendPortsStateCount--;
@@ -131,8 +143,15 @@ void uart_send_tcu_data() {
 	// Пересчет оборотов в метры для отправки.
 	TCU.MeterCounter = get_meters_count();
 
+	// Метка времени пакета.
+	uint32_t Ms = 0;
+	uint8_t Sub = 0;
+	get_timestamp(&Ms, &Sub);
+	TCU.Timestamp = Ms;
+	TCU.TimestampSub = Sub;
+	TCU.UartDropped = TxDropped;
+
 	TxBuffPos = 0;	// Сброс позиции.
-	UseMarkers = 1;	// Используем байты маркеры.
 	SendBuffer[TxBuffPos++] = FOBEGIN;			// Байт начала пакета.
 	SendBuffer[TxBuffPos++] = TCU_DATA_PACKET;	// Тип данных.
 
@@ -145,7 +164,6 @@ void uart_send_tcu_data() {
 
 void uart_send_cfg_data() {
 	TxBuffPos = 0;				// Сброс позиции.
-	UseMarkers = 1;				// Используем байты маркеры.
 	SendBuffer[TxBuffPos++] = FOBEGIN;				// Байт начала пакета.
 	SendBuffer[TxBuffPos++] = TCU_CONFIG_ANSWER;	// Тип данных.
 
@@ -168,7 +186,6 @@ static void uart_write_cfg_data() {
 
 void uart_send_table(uint8_t N) {
 	TxBuffPos = 0;	// Сброс позиции.
-	UseMarkers = 1;	// Используем байты маркеры.
 	SendBuffer[TxBuffPos++] = FOBEGIN;			// Байт начала пакета.
 	SendBuffer[TxBuffPos++] = TCU_TABLE_ANSWER;	// Тип данных - таблица.
 	SendBuffer[TxBuffPos++] = N;				// Номер таблицы.
@@ -258,17 +275,16 @@ void uart_send_table(uint8_t N) {
 
 		default:	// Неверный номер таблицы.
 			TxBuffPos = 0;
-			UseMarkers = 0;
 			return;
 	}
+	uart_buffer_add_timestamp();	// Метка времени в конце таблицы.
 	uart_send_array();	// Отправляем в UART.
 }
 
 static void uart_send_ports_state() {
-	if (!TxReady) {return;}
+	if (!uart_tx_ready()) {return;}
 
 	TxBuffPos = 0;
-	UseMarkers = 1;
 
 	SendBuffer[TxBuffPos++] = FOBEGIN;
 	SendBuffer[TxBuffPos++] = PORTS_STATE_PACKET;
@@ -314,15 +330,112 @@ static void uart_send_ports_state() {
 
 static void uart_send_version() {
 	TxBuffPos = 0;	// Сброс позиции.
-	UseMarkers = 1;	// Используем байты маркеры.
 	SendBuffer[TxBuffPos++] = FOBEGIN;				// Байт начала пакета.
 	SendBuffer[TxBuffPos++] = TCU_VERSION_ANSWER;	// Тип данных - версия прошивки.
 	uart_buffer_add_uint16(APP.FirmwareVersion);		// Версия прошивки.
 	uart_send_array();	// Отправляем в UART.
 }
 
+// Причина сброса и запись о последнем сбросе по сторожевому таймеру.
+void uart_send_crash_report() {
+	if (!uart_tx_ready()) {return;}		// Не трогать буффер пока идет передача.
+
+	CRASH_t* Crash = watchdog_get_crash();
+	uint8_t Valid = 0;
+	if (Crash->Marker == CRASH_MARKER_NEW || Crash->Marker == CRASH_MARKER_OLD) {Valid = 1;}
+
+	TxBuffPos = 0;	// Сброс позиции.
+	SendBuffer[TxBuffPos++] = FOBEGIN;				// Байт начала пакета.
+	SendBuffer[TxBuffPos++] = CRASH_REPORT_PACKET;	// Тип данных.
+	uart_buffer_add_uint8(watchdog_get_reset_flags());	// Флаги MCUSR.
+	uart_buffer_add_uint8(watchdog_is_fresh());			// Сброс вызван записанным событием.
+	uart_buffer_add_uint8(Valid);						// Запись есть в EEPROM.
+	uart_buffer_add_uint16(Valid ? Crash->Count : 0);
+	uart_buffer_add_uint8(Crash->Task);
+	uart_buffer_add_uint32(Crash->Address);
+	uart_buffer_add_uint8(Crash->Gear);
+	uart_buffer_add_uint8(Crash->GearStep);
+	uart_buffer_add_uint8(Crash->ATMode);
+	uart_buffer_add_uint32(Crash->Uptime);
+	uart_send_array();	// Отправляем в UART.
+}
+
+// Статистика времени выполнения.
+// Страница 0 - функции, страница 1 - задачи планировщика.
+static void uart_send_profile(uint8_t Page) {
+	TxBuffPos = 0;	// Сброс позиции.
+	SendBuffer[TxBuffPos++] = FOBEGIN;			// Байт начала пакета.
+	SendBuffer[TxBuffPos++] = PROFILE_PACKET;	// Тип данных.
+	uart_buffer_add_uint8(Page);
+
+	if (Page == 0) {
+		uart_buffer_add_uint8(PROF_COUNT);
+		for (uint8_t i = 0; i < PROF_COUNT; i++) {
+			uart_buffer_add_uint16(profiler_get_min(i));
+			uart_buffer_add_uint16(profiler_get_avg(i));
+			uart_buffer_add_uint16(profiler_get_max(i));
+			for (uint8_t j = 0; j < PROF_HIST_SIZE; j++) {uart_buffer_add_uint8(profiler_get_hist(i, j));}
+		}
+	}
+	else {
+		uart_buffer_add_uint8(scheduler_get_count());
+		for (uint8_t i = 0; i < scheduler_get_count(); i++) {
+			uart_buffer_add_uint16(scheduler_get_jitter(i));
+			uart_buffer_add_uint16(scheduler_get_overruns(i));
+		}
+	}
+	uart_send_array();	// Отправляем в UART.
+}
+
+// Максимальное время запрета прерываний по местам вызова.
+// Страница Page содержит места с Page * CRITICAL_PAGE_SIZE.
+static void uart_send_critical(uint8_t Page) {
+	TxBuffPos = 0;	// Сброс позиции.
+	SendBuffer[TxBuffPos++] = FOBEGIN;					// Байт начала пакета.
+	SendBuffer[TxBuffPos++] = CRITICAL_STATS_PACKET;	// Тип данных.
+	uart_buffer_add_uint8(Page);
+
+	uint8_t Count = critical_get_count();
+	uint8_t First = Page * CRITICAL_PAGE_SIZE;
+	uint8_t Size = 0;
+	if (Count > First) {Size = MIN(Count - First, CRITICAL_PAGE_SIZE);}
+
+	uart_buffer_add_uint8(Count);
+	uart_buffer_add_uint8(Size);
+	for (uint8_t i = First; i < First + Size; i++) {
+		char Name[CRITICAL_NAME_SIZE];
+		critical_get_name(i, Name);
+		for (uint8_t j = 0; j < CRITICAL_NAME_SIZE; j++) {uart_buffer_add_uint8(Name[j]);}
+		uart_buffer_add_uint16(critical_get_line(i));
+		uart_buffer_add_uint16(critical_get_max(i));
+		uart_buffer_add_uint16(critical_get_calls(i));
+	}
+	// Места вызова, не попавшие в таблицу, в конце пакета.
+	uart_buffer_add_uint8(critical_get_dropped());
+	uart_send_array();	// Отправляем в UART.
+}
+
+// История событий входов, от старых к новым.
+static void uart_send_events() {
+	TxBuffPos = 0;	// Сброс позиции.
+	SendBuffer[TxBuffPos++] = FOBEGIN;			// Байт начала пакета.
+	SendBuffer[TxBuffPos++] = EVENTS_PACKET;	// Тип данных.
+	uart_buffer_add_uint16(events_get_lost());	// Потерянные события.
+
+	uint8_t Count = events_get_history_count();
+	uart_buffer_add_uint8(Count);
+	for (uint8_t i = 0; i < Count; i++) {
+		EVENT_t* Event = events_get_history(i);
+		uart_buffer_add_uint8(Event->Type);
+		uart_buffer_add_uint8(Event->Data);
+		uart_buffer_add_uint32(Event->Time);
+		uart_buffer_add_uint8(Event->Sub);
+	}
+	uart_send_array();	// Отправляем в UART.
+}
+
 void uart_command_processing() {
-	if (!TxReady) {return;}		// Не трогать буфер пока идет передача.
+	if (!uart_tx_ready()) {return;}		// Не трогать буфер пока идет передача.
 
 	if (RxCommandStatus != 2) {return;}
 
@@ -353,7 +466,7 @@ void uart_command_processing() {
 			break;
 		case NEW_REV_COUNTER:
 			if (RxBuffPos == 6) {
-				APP.RevCounter = ((uint32_t) uart_build_uint32(2) / CFG.MeterCalcCoef) << 8;
+				set_rev_counter(((uint32_t) uart_build_uint32(2) / CFG.MeterCalcCoef) << 8);
 				update_eeprom_add_variables();
 			}
 			break;
@@ -372,6 +485,26 @@ void uart_command_processing() {
 		case GET_PORTS_STATE:
 			SendPortsStateCount = SEND_PORT_STATE_COUNT;
 			break;
+		case GET_PROFILE_COMMAND:
+			uart_send_profile(ReceiveBuffer[1]);
+			break;
+		case RESET_PROFILE_COMMAND:
+			if (RxBuffPos == 3 && ReceiveBuffer[2] == RESET_PROFILE_COMMAND) {
+				profiler_clear();
+				scheduler_clear_stats();
+				critical_clear();
+				uart_send_profile(ReceiveBuffer[1]);
+			}
+			break;
+		case GET_CRITICAL_COMMAND:
+			uart_send_critical(ReceiveBuffer[1]);
+			break;
+		case GET_CRASH_COMMAND:
+			uart_send_crash_report();
+			break;
+		case GET_EVENTS_COMMAND:
+			uart_send_events();
+			break;
 		case READ_EEPROM_MAIN_COMMAND:
 			if (RxBuffPos == 3 && ReceiveBuffer[2] == READ_EEPROM_MAIN_COMMAND) {
 				read_eeprom_tables();
@@ -518,8 +651,6 @@ void uart_command_processing() {
 
 // Отправить массив в UART.
 void uart_send_array() {
-	CurrUART = NextUART;	// Переключаемся на другой UART.
-
 	// Добавляем два байта контрольной суммы.
 	CRC[0] = 0;
 	CRC[1] = 0;
@@ -537,8 +668,18 @@ void uart_send_array() {
 
 	SendBuffer[TxBuffPos++] = FIOEND;
 
-	TxMsgSize = TxBuffPos;		// Количество байт на отправку.
-	TxReady = 0;				// UART занят.
+	// Пакет с байтом длины не помещается в очередь, отбрасываем.
+	if (TxBuffPos + 1 > RING_FREE(TxRing)) {
+		if (TxDropped < UINT16_MAX) {TxDropped++;}
+		TxBuffPos = 0;
+		return;
+	}
+
+	// Переключаемся на другой UART, только если очередь пуста и пакет отправлен.
+	if (RING_EMPTY(TxRing) && !TxLeft) {CurrUART = NextUART;}
+
+	RING_PUSH(TxRing, TxBuffPos);
+	for (uint8_t i = 0; i < TxBuffPos; i++) {RING_PUSH(TxRing, SendBuffer[i]);}
 	TxBuffPos = 0;				// Сбрасываем позицию в массиве.
 
 	// Включаем прерывание по опустошению буфера.
@@ -546,15 +687,10 @@ void uart_send_array() {
 	else {UCSR0B |= (1 << UDRIE0);}					// UART0.
 }
 
-// Возвращает готовность интерфейса к новому заданию.
+// Возвращает готовность интерфейса к новому заданию,
+// в очереди есть место для пакета максимального размера и байта длины.
 uint8_t uart_tx_ready() {
-	uint8_t RD = 0;
-	cli();
-		if (CurrUART) {RD = UCSR1A & (1 << UDRE1);}		// UART1.
-		else {RD = UCSR0A & (1 << UDRE0);}				// UART0.
-	sei();
-
-	if (RD && TxReady) {return 1;}	// Буфер свободен и не идет пакетная отправка.
+	if (RING_FREE(TxRing) >= UART_TX_BUFFER_SIZE + 1) {return 1;}
 	else {return 0;}
 }
 
@@ -686,6 +822,20 @@ static void uart_buffer_add_int16(int16_t Value) {
 	SendBuffer[TxBuffPos++] = *(pValue + 1);
 }
 
+static void uart_buffer_add_uint32(uint32_t Value) {
+	uint8_t *pValue = (uint8_t*)&Value;
+	for (uint8_t i = 0; i < 4; i++) {SendBuffer[TxBuffPos++] = *(pValue + i);}
+}
+
+// Метка времени, 4 байта мс и 1 байт доли миллисекунды (10 мкс).
+static void uart_buffer_add_timestamp() {
+	uint32_t Ms = 0;
+	uint8_t Sub = 0;
+	get_timestamp(&Ms, &Sub);
+	uart_buffer_add_uint32(Ms);
+	uart_buffer_add_uint8(Sub);
+}
+
 // Сборка int из двух байт
 static int16_t uart_build_int16(uint8_t i) {
 	int16_t Value = 0;
@@ -716,51 +866,52 @@ static uint32_t uart_build_uint32(uint8_t i) {
 }
 
 static void uart_udre_vect() {
-	uint8_t SendByte = SendBuffer[TxBuffPos];
-	
-	if (UseMarkers) {		// Используются маркеры.
-		if (TxMarkerByte) {			// Если был маркер.
-			SendByte = TxMarkerByte;	// Отправляем символ-замену.
-			TxMarkerByte = 0;			// Сбрасываем маркер.
-			TxBuffPos++;
+	uint8_t SendByte = 0;
+
+	if (TxMarkerByte) {			// Если был маркер.
+		SendByte = TxMarkerByte;	// Отправляем символ-замену.
+		TxMarkerByte = 0;			// Сбрасываем маркер.
+		TxLeft--;
+	}
+	else {
+		// Начало пакета, первый байт в очереди - длина.
+		if (!TxLeft && !RING_EMPTY(TxRing)) {
+			TxSize = RING_PEEK(TxRing, 0);
+			TxLeft = TxSize;
+			RING_COMMIT(TxRing, 1);
+		}
+		if (!TxLeft || RING_EMPTY(TxRing)) {
+			// Очередь пуста или пакет еще добавляется, запрещаем прерывание.
+			UCSR1B &=~ (1 << UDRIE1);
+			UCSR0B &=~ (1 << UDRIE0);
+			return;
 		}
+
+		SendByte = RING_PEEK(TxRing, 0);
+		RING_COMMIT(TxRing, 1);
+
 		// Первый и последний байт - исключение.
-		else if (TxBuffPos > 0 && TxBuffPos < TxMsgSize - 1) {
+		if (TxLeft != TxSize && TxLeft > 1) {
 			switch (SendByte) {
 				case FOBEGIN:		// Если байт совпадает с маркером.
-					SendByte = FESC;	// Отправляем символ подмены байта
-					TxMarkerByte = TFOBEGIN;	// и оставляем маркер.
+					TxMarkerByte = TFOBEGIN;	// Оставляем маркер.
 					break;
 				case FIOEND:
-					SendByte = FESC;
 					TxMarkerByte = TFIOEND;
 					break;
 				case FESC:
-					SendByte = FESC;
 					TxMarkerByte = TFESC;
 					break;
-				default:
-					TxBuffPos++;	// Если нет совпадения, переходим к следующему байту.
 			}
 		}
-		else {TxBuffPos++;}
+		// Отправляем символ подмены байта, иначе переходим к следующему байту.
+		if (TxMarkerByte) {SendByte = FESC;}
+		else {TxLeft--;}
 	}
-	else {TxBuffPos++;}
 
 	// Загружаем очередной байт в активный UART.
 	if (CurrUART) {UDR1 = SendByte;}		// UART1.
 	else {UDR0 = SendByte;}					// UART0.
-
-	if (TxBuffPos >= TxMsgSize) {		// Все данные загружены в буфер отправки.
-		// Запрещаем прерывание.
-		UCSR1B &=~ (1 << UDRIE1);
-		UCSR0B &=~ (1 << UDRIE0);
-	}
-}
-
-static void uart_tx_vect() {
-	TxReady = 1;
-	UseMarkers = 0;
 }
 
 static void uart_rx_vect() {
@@ -819,10 +970,6 @@ static void uart_rx_vect() {
 ISR (USART0_UDRE_vect) {uart_udre_vect();}	// UART0.
 ISR (USART1_UDRE_vect) {uart_udre_vect();}	// UART1.
 
-// Прерывание по окончании передачи.
-ISR (USART0_TX_vect) {uart_tx_vect();}	// UART0.
-ISR (USART1_TX_vect) {uart_tx_vect();}	// UART1.
-
 // Прерывание по окончании приема.
 ISR (USART0_RX_vect) {	// UART0.
 	NextUART = 0;
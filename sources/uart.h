@@ -8,6 +8,7 @@
 	void uart_send_tcu_data();
 	void uart_send_cfg_data();
 	void uart_send_table(uint8_t N);
+	void uart_send_crash_report();
 	void uart_command_processing();
 
 	void uart_send_array();
@@ -23,6 +24,10 @@
 	#define TFESC		0x84	// Измененный FESC
 
 	#define TCU_DATA_PACKET 0x71		// Стандартный пакет с данными.
+	#define PROFILE_PACKET	0x72		// Пакет со статистикой времени выполнения.
+	#define CRITICAL_STATS_PACKET	0x73	// Пакет с временем запрета прерываний.
+	#define CRASH_REPORT_PACKET	0x74		// Пакет с причиной сброса и записью о сбросе.
+	#define EVENTS_PACKET			0x75	// Пакет с историей событий входов.
 
 	#define GET_VERSION_COMMAND	0xb0	// Запрос версии прошивки.
 	#define TCU_VERSION_ANSWER	0xb1	// Ответ с версей прошивки.
@@ -40,6 +45,12 @@
 	#define GET_PORTS_STATE		0xc7	// Запрос статуса портов.
 	#define PORTS_STATE_PACKET	0xc8	// Ответ со статусами портов.
 
+	#define GET_PROFILE_COMMAND		0xc9	// Запрос статистики времени выполнения.
+	#define RESET_PROFILE_COMMAND	0xca	// Сброс статистики времени выполнения.
+	#define GET_CRITICAL_COMMAND	0xcb	// Запрос времени запрета прерываний.
+	#define GET_CRASH_COMMAND		0xcc	// Запрос записи о сбросе по сторожевому таймеру.
+	#define GET_EVENTS_COMMAND		0xcd	// Запрос истории событий входов.
+
 	#define READ_EEPROM_MAIN_COMMAND	0xe0	// Считать EEPROM - Таблицы.
 	#define READ_EEPROM_ADC_COMMAND		0xe1	// Считать EEPROM - АЦП.
 	#define READ_EEPROM_SPEED_COMMAND	0xe2	// Считать EEPROM - Скорость.
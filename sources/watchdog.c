@@ -0,0 +1,92 @@
+#include <stdint.h>			// Коротние название int.
+#include <avr/io.h>			// Названия регистров и номера бит.
+#include <avr/interrupt.h>	// Прерывания.
+#include <avr/wdt.h>		// Сторожевой собак.
+#include <avr/eeprom.h>		// EEPROM.
+
+#include "watchdog.h"		// Свой заголовок.
+#include "eeprom.h"			// Чтение и запись EEPROM.
+#include "tcudata.h"		// Расчет и хранение всех необходимых параметров.
+#include "scheduler.h"		// Планировщик задач.
+#include "timers.h"			// Таймеры.
+
+// Флаги причины сброса, не очищается при запуске.
+static uint8_t ResetFlags __attribute__ ((section(".noinit")));
+
+static CRASH_t Crash = {0};		// Запись о последнем сбросе.
+static uint8_t Fresh = 0;		// Запись относится к текущему запуску.
+
+void watchdog_record(uint8_t* Stack) __attribute__ ((used, noinline));
+
+// Сохранение флагов сброса и отключение сторожевого таймера, выполняется до main.
+void watchdog_boot() __attribute__ ((naked, used, section(".init3")));
+void watchdog_boot() {
+	ResetFlags = MCUSR;
+	MCUSR = 0;
+	wdt_disable();
+}
+
+// Включение сторожевого таймера в режиме прерывание + сброс.
+// Timeout - значение WDTO_xxx из avr/wdt.h.
+void watchdog_enable(uint8_t Timeout) {
+	uint8_t Value = (1 << WDIE) | (1 << WDE) | (Timeout & 0x07);
+	if (Timeout & 0x08) {Value |= (1 << WDP3);}
+
+	uint8_t SaveSREG = SREG;
+	cli();
+		wdt_reset();
+		// Изменение настроек должно быть выполнено за 4 такта после WDCE.
+		WDTCSR = (1 << WDCE) | (1 << WDE);
+		WDTCSR = Value;
+	SREG = SaveSREG;
+}
+
+// Чтение записи о сбросе при запуске.
+void watchdog_init() {
+	eeprom_read_block((void*) &Crash, (const void*) CRASH_START_BYTE, sizeof(Crash));
+	if (Crash.Marker != CRASH_MARKER_NEW) {return;}
+
+	// Запись сделана перед этим сбросом.
+	if (ResetFlags & (1 << WDRF)) {Fresh = 1;}
+	eeprom_update_byte((uint8_t*) CRASH_START_BYTE, CRASH_MARKER_OLD);
+}
+
+uint8_t watchdog_get_reset_flags() {
+	return ResetFlags;
+}
+
+// Возвращает 1, если запись сделана перед последним сбросом.
+uint8_t watchdog_is_fresh() {
+	return Fresh;
+}
+
+CRASH_t* watchdog_get_crash() {
+	return &Crash;
+}
+
+// Запись состояния ЭБУ, Stack - указатель стека при входе в прерывание.
+void watchdog_record(uint8_t* Stack) {
+	CRASH_t Record;
+	eeprom_read_block((void*) &Record, (const void*) CRASH_START_BYTE, sizeof(Record));
+	if (Record.Marker != CRASH_MARKER_NEW && Record.Marker != CRASH_MARKER_OLD) {Record.Count = 0;}
+
+	Record.Marker = CRASH_MARKER_NEW;
+	if (Record.Count < UINT16_MAX) {Record.Count++;}
+	Record.Task = scheduler_get_current();
+	// Адрес возврата (3 байта, старший первым) лежит над вершиной стека.
+	Record.Address = (((uint32_t) Stack[1] << 16) | ((uint16_t) Stack[2] << 8) | Stack[3]) << 1;
+	Record.Gear = TCU.Gear;
+	Record.GearStep = TCU.GearStep;
+	Record.ATMode = TCU.ATMode;
+	Record.Uptime = get_time_ms();
+
+	eeprom_update_block((void*) &Record, (void*) CRASH_START_BYTE, sizeof(Record));
+}
+
+// Прерывание сторожевого таймера, следующее срабатывание вызовет сброс.
+// Без пролога, чтобы указатель стека указывал на адрес возврата.
+ISR (WDT_vect, ISR_NAKED) {
+	asm volatile ("clr __zero_reg__");
+	watchdog_record((uint8_t*) SP);
+	while (1) {}	// Ждем сброса.
+}
@@ -0,0 +1,38 @@
+// Сторожевой таймер с записью причины сброса в EEPROM.
+
+#ifndef _WATCHDOG_H_
+	#define _WATCHDOG_H_
+
+	#define CRASH_MARKER_NEW	0xa5	// Запись сделана перед последним сбросом.
+	#define CRASH_MARKER_OLD	0x5a	// Запись уже была отправлена после сброса.
+
+	// Запись о сбросе по сторожевому таймеру.
+	typedef struct CRASH_t {
+		uint8_t Marker;			// Признак наличия записи.
+		uint16_t Count;			// Количество сбросов.
+		uint8_t Task;			// Номер выполняемой задачи планировщика (255 - вне задачи).
+		uint32_t Address;		// Адрес возврата из прерывания (байтовый).
+		int8_t Gear;			// Текущая передача.
+		uint8_t GearStep;		// Номер шага процесса переключения.
+		uint8_t ATMode;			// Режим АКПП.
+		uint32_t Uptime;		// Время от включения, мс.
+	} CRASH_t;
+
+	void watchdog_enable(uint8_t Timeout);
+	void watchdog_init();
+	uint8_t watchdog_get_reset_flags();
+	uint8_t watchdog_is_fresh();
+	CRASH_t* watchdog_get_crash();
+
+#endif
+
+/*
+	Сторожевой таймер работает в режиме "прерывание + сброс".
+	При первом срабатывании выполняется прерывание, в котором
+	состояние ЭБУ записывается в EEPROM (CRASH_START_BYTE),
+	при следующем срабатывании происходит сброс.
+
+	Флаги причины сброса (MCUSR) сохраняются при запуске до main
+	(секция .init3), там же сторожевой таймер отключается.
+	Флаги равны 0 при программном перезапуске (переход на нулевой адрес).
+*/